@@ -1,27 +1,165 @@
 #ifndef YU_AUDIO_H
 #define YU_AUDIO_H
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "breakout/spsc_queue.hpp"
+
 struct ma_engine;
 struct ma_sound;
 
+/* Sound effect loaded by AudioEngine::load_effect */
+struct SoundHandle {
+  static constexpr uint16_t INVALID = UINT16_MAX;
+
+  uint16_t index = INVALID;
+
+  bool is_valid() const { return index != INVALID; }
+};
+
+/* How an effect shares the voices with the others */
+struct EffectOptions {
+  /* Voices reserved for the effect, the oldest one restarts past the cap */
+  uint8_t max_voices = 2;
+  /* Triggers closer than this to the previous one are dropped */
+  float min_interval = 0.0f;
+  /* Effects steal voices from lower priority ones when the mixer is full */
+  uint8_t priority = 0;
+};
+
+enum class AudioBackend {
+  /* Play through the default playback device */
+  DEVICE = 0,
+  /* Mix into memory whenever AudioEngine::advance is called, without a device
+   * or its thread, for headless runs and benchmarks */
+  OFFLINE,
+  /* No engine at all, every sound is silently dropped */
+  DISABLED,
+};
+
+/* Everything that starts, stops or changes a sound is queued by the game
+ * thread and executed by the mixer at the start of its next period, so
+ * neither side ever waits for the other */
 class AudioEngine {
   friend class Sound;
 
 public:
-  AudioEngine();
+  /* Voices that can be reserved by all the effects together */
+  static constexpr size_t MAX_VOICES = 32;
+  /* Voices that are mixed at the same time */
+  static constexpr size_t MAX_PLAYING = 8;
+  /* Output format of the offline backend */
+  static constexpr uint32_t OFFLINE_SAMPLE_RATE = 48000;
+  static constexpr uint32_t OFFLINE_CHANNELS = 2;
+  /* Commands that can be queued between two mix periods */
+  static constexpr size_t COMMAND_CAPACITY = 256;
+
+public:
+  AudioEngine(AudioBackend backend = AudioBackend::DEVICE);
   AudioEngine(const AudioEngine &) = delete;
   AudioEngine(AudioEngine &&) = delete;
   AudioEngine &operator=(const AudioEngine &) = delete;
   AudioEngine &operator=(AudioEngine &&) = delete;
   ~AudioEngine();
 
-  bool play(const char *filename) const;
+  /* Decode a sound effect to PCM in the engine's format and bind it to its
+   * voices, so that playing it touches neither the filesystem, the decoder
+   * nor the allocator */
+  SoundHandle load_effect(const char *filename,
+                          const EffectOptions &options = EffectOptions());
+  /* Identical triggers between two calls are coalesced into one */
+  void begin_tick() { ++m_tick; }
+  /* Queue the effect, returns false if the trigger was dropped */
+  bool play(SoundHandle effect);
+
+  /* Mix `seconds` of audio and move the engine's clock forward. Only the
+   * offline backend needs it, the others ignore it */
+  void advance(float seconds);
+  /* Offline backend only, mix `frame_count` interleaved frames into `output`
+   * and return how many were written */
+  uint64_t mix(float *output, uint64_t frame_count);
+
+  /* Voices of effects that are currently being mixed */
+  size_t playing_voices() const;
+  /* Commands rejected by a full queue, reported again at shutdown */
+  uint64_t dropped_commands() const {
+    return m_dropped_commands.load(std::memory_order_relaxed);
+  }
 
+  AudioBackend backend() const { return m_backend; }
   bool is_initialized() const { return m_engine_initialized; }
 
 private:
+  enum class CommandType : uint8_t {
+    PLAY_EFFECT = 0,
+    PLAY_SOUND,
+    STOP_SOUND,
+    SET_VOLUME,
+  };
+
+  struct Command {
+    CommandType type;
+    /* PLAY_EFFECT */
+    uint8_t priority;
+    uint8_t first_voice;
+    uint8_t voice_count;
+    /* SET_VOLUME */
+    float volume;
+    /* PLAY_SOUND, STOP_SOUND and SET_VOLUME */
+    ma_sound *sound;
+  };
+
+  struct Effect {
+    void *frames;
+    uint64_t frame_count;
+    size_t first_voice;
+    size_t voice_count;
+    uint64_t min_interval;
+    uint64_t last_trigger;
+    uint64_t last_tick;
+    uint8_t priority;
+  };
+  struct Voice;
+  struct PackVFS;
+  struct Device;
+
+  /* Game thread */
+  bool push(const Command &command);
+  /* Wait until the mixer has executed every queued command */
+  void flush();
+
+  /* Mixer */
+  uint64_t mix_period(float *output, uint64_t frame_count);
+  void execute_commands();
+  void start_effect(const Command &command);
+  Voice *steal_voice(uint8_t priority);
+
+  AudioBackend m_backend;
   ma_engine *m_engine;
   bool m_engine_initialized;
+  std::unique_ptr<PackVFS> m_vfs;
+  std::unique_ptr<Device> m_device;
+  SpscQueue<Command, COMMAND_CAPACITY> m_commands;
+  /* Commands queued by the game thread, and executed by the mixer. The
+   * queue empties as soon as a command is popped, before it has run, so
+   * flush() waits on the executed count instead */
+  uint64_t m_pushed_commands = 0;
+  std::atomic<uint64_t> m_executed_commands{0};
+  /* Counted rather than logged, push() is on the game thread's hot path */
+  std::atomic<uint64_t> m_dropped_commands{0};
+
+  /* Scratch output of `advance` and the fraction of a frame it owes */
+  std::vector<float> m_mix_buffer;
+  double m_mix_remainder = 0.0;
+
+  std::vector<Effect> m_effects;
+  std::unique_ptr<Voice[]> m_voices;
+  size_t m_voice_count = 0;
+  uint64_t m_tick = 1;
 };
 
 class Sound {
@@ -33,8 +171,14 @@ public:
   Sound &operator=(Sound &&) = delete;
   ~Sound();
 
-  bool load(const char *filename, bool loop = false, float volume = 1.0f);
+  /* A streamed sound is decoded a page at a time by the engine's job thread
+   * instead of entirely up front, which suits long music tracks */
+  bool load(const char *filename, bool loop = false, float volume = 1.0f,
+            bool stream = false);
+  /* Queued like effects, return false if the command was dropped */
   bool play() const;
+  bool stop() const;
+  bool set_volume(float volume) const;
 
   bool is_loaded() const { return m_loaded; }
 
@@ -20,7 +20,7 @@ public:
   BallObject &operator=(const BallObject &) = default;
   BallObject &operator=(BallObject &&) = delete;
   BallObject(glm::vec2 pos, float radius, glm::vec2 velocity,
-             std::shared_ptr<Texture2D> sprite);
+             TextureHandle sprite);
   glm::vec2 move(float dt, uint32_t window_width, uint32_t window_height);
   void reset(glm::vec2 pos, glm::vec2 velocity);
 
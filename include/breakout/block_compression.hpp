@@ -0,0 +1,41 @@
+#ifndef YU_BLOCK_COMPRESSION_H
+#define YU_BLOCK_COMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* BC1/BC3 (S3TC) texture compression and the DDS container they are
+ * stored in. Encoding is done offline by the `texcompress` tool */
+namespace BlockCompression {
+
+enum class Format {
+  BC1 = 0, /* RGB, 8 bytes per 4x4 block */
+  BC3,     /* RGBA, 16 bytes per 4x4 block */
+};
+
+struct Image {
+  Format format;
+  uint32_t width, height;
+  uint32_t levels;
+  /* All mip levels back to back, largest first */
+  const unsigned char *data;
+  size_t size;
+};
+
+size_t block_size(Format format);
+size_t level_size(Format format, uint32_t width, uint32_t height);
+uint32_t gl_format(Format format);
+
+/* Compress RGBA8 `pixels` with a full mip chain */
+std::vector<unsigned char> encode(Format format, const unsigned char *pixels,
+                                  uint32_t width, uint32_t height,
+                                  uint32_t *levels);
+
+bool write_dds(const char *path, const Image &image);
+/* Points `image` into `data` without copying */
+bool parse_dds(const unsigned char *data, size_t size, Image &image);
+
+} // namespace BlockCompression
+
+#endif /* !YU_BLOCK_COMPRESSION_H */
@@ -2,23 +2,31 @@
 #define YU_GAME_H
 
 #include <cstdint>
+#include <future>
 #include <memory>
+#include <random>
+#include <string>
 #include <vector>
 
 #include <glm/vec2.hpp>
 
+#include "breakout/audio.hpp"
+#include "breakout/gamelevel.hpp"
+#include "breakout/gpu_timer.hpp"
+#include "breakout/input.hpp"
+#include "breakout/postprocessor.hpp"
+#include "breakout/stats_overlay.hpp"
+#include "breakout/texture_handle.hpp"
+
 /* Forward declarations */
 class ParticleGenerator;
 class SpriteRenderer;
-class GameLevel;
 class GameObject;
 class BallObject;
-class PostProcessor;
 class PowerUp;
+class ResourceManager;
 class TextRenderer;
 class Player;
-class AudioEngine;
-class Sound;
 
 enum class GameState {
   ACTIVE = 0,
@@ -34,22 +42,89 @@ struct Collision {
   bool collided;
 };
 
+/* Collision tests, shared with the benchmarks */
+glm::vec2 vector_direction(glm::vec2 target);
+Collision check_collision(BallObject &one, GameObject &two);
+bool check_collision(const GameObject &one, const GameObject &two);
+/* The first brick left standing that `ball` hits, or null */
+GameObject *find_box_collision(BallObject &ball,
+                               std::vector<GameObject> &bricks,
+                               Collision &collision);
+
 class BreakoutGame {
+public:
+  /* Heap allocations made by the last call of each phase */
+  struct Allocations {
+    uint64_t input = 0;
+    uint64_t update = 0;
+    uint64_t render = 0;
+  };
+
 public:
   BreakoutGame(const BreakoutGame &) = delete;
   BreakoutGame(BreakoutGame &&) = delete;
   BreakoutGame &operator=(const BreakoutGame &) = delete;
   BreakoutGame &operator=(BreakoutGame &&) = delete;
-  BreakoutGame(uint32_t width, uint32_t height);
+  /* Resources come from `resources`, or from the process-wide registry if
+   * null. Each game owns its input, so that several can run side by side */
+  BreakoutGame(uint32_t width, uint32_t height,
+               AudioBackend audio_backend = AudioBackend::DEVICE,
+               ResourceManager *resources = nullptr);
   ~BreakoutGame();
 
+  /* Needs a current OpenGL context */
   void init();
+  /* Set up everything but rendering, without touching OpenGL. `render` must
+   * not be called afterwards */
+  void init_simulation();
   void process_input(float dt);
   void update(float dt);
   void render();
+  /* Pick up changed resources, returns true if anything was reloaded */
+  bool hot_reload();
+
+  /* Whether there is anything for `update` to advance */
+  bool is_simulating() const;
+  /* Whether the rendered frame changes over time without any input */
+  bool is_animated() const;
+
+  Input &input() { return m_input; }
+
+  /* Read-only views of the simulation, for autopilots and tools */
+  GameState state() const { return m_state; }
+  const BallObject &ball() const;
+  const Player &player() const;
+  const std::vector<PowerUp> &powerups() const { return m_powerups; }
+  size_t current_level() const { return m_current_level; }
+  size_t level_count() const { return m_levels.size(); }
+  int32_t lives() const { return m_lives; }
+  const Allocations &allocations() const { return m_allocations; }
+  /* Background level loads started so far. Starting one allocates, which
+   * tools tell apart from steady-state work with this */
+  uint64_t preloads_started() const { return m_preloads_started; }
+
+  /* Power-up spawns and particles are drawn from the game's own engines, so
+   * games running side by side are independent and a seed replays the same
+   * run */
+  void seed(uint32_t seed);
+
+  /* F3 toggles the statistics overlay while playing */
+  void set_stats_visible(bool visible);
 
 private:
+  void init_world();
+  void init_graphics();
+
   void load_levels();
+  void load_level(size_t index);
+  /* Make `index` the current level, waiting for it if it isn't loaded yet */
+  void select_level(size_t index);
+  /* Parse a level on a worker thread, one at a time */
+  void preload_level(size_t index);
+  /* Adopt a level parsed in the background and start on the next one */
+  void poll_preload();
+  /* Load the textures needed to play a level in one batch */
+  void prefetch_level(size_t index);
 
   void spawn_powerups(glm::vec2 position);
   void update_powerups(float dt);
@@ -59,30 +134,71 @@ private:
   void resolve_powerup_collisions();
   void resolve_player_collisions();
 
+  void enable_effect(PostProcessor::Effect effect);
+  void disable_effect(PostProcessor::Effect effect);
+  bool is_effect_enabled(PostProcessor::Effect effect) const;
+
+  /* Sums up and resets the renderers' counters of the last frame */
+  StatsOverlay::Counters collect_stats();
+
   void activate_powerup(PowerUp &power_up);
   void reset_player();
   void reset_level();
 
 private:
+  ResourceManager *m_resources;
+  Input m_input;
+  /* Whether init() set up rendering */
+  bool m_graphics = false;
+
   std::vector<GameLevel> m_levels;
+  std::vector<uint8_t> m_level_loaded;
+  std::future<GameLevel> m_preload;
+  size_t m_preload_index = 0;
+  uint64_t m_preloads_started = 0;
+  GameLevel::Sprites m_level_sprites;
   std::vector<PowerUp> m_powerups;
   size_t m_current_level;
 
   int32_t m_lives;
+  std::minstd_rand m_random;
+  uint32_t m_seed = std::minstd_rand::default_seed;
 
   std::unique_ptr<SpriteRenderer> m_renderer;
   std::unique_ptr<ParticleGenerator> m_particles;
   std::unique_ptr<PostProcessor> m_postprocessor;
   std::unique_ptr<TextRenderer> m_text_renderer;
+#ifdef BREAKOUT_PROFILER
+  std::unique_ptr<Profiler::GpuTimer> m_gpu_timer;
+#endif /* BREAKOUT_PROFILER */
+  StatsOverlay m_stats_overlay;
+  Allocations m_allocations;
 
   std::unique_ptr<Player> m_player;
   std::unique_ptr<BallObject> m_ball;
 
+  AudioBackend m_audio_backend;
   std::unique_ptr<AudioEngine> m_audio_engine;
   std::unique_ptr<Sound> m_main_theme;
-  std::unique_ptr<Sound> m_paddle_sound;
+
+  /* Sound effects, decoded once in init() */
+  SoundHandle m_solid_sound;
+  SoundHandle m_block_sound;
+  SoundHandle m_powerup_sound;
+  SoundHandle m_paddle_sound;
+
+  /* Resolved once in init(), `m_powerup_textures` is parallel to the power-up
+   * table. `m_common_textures` are used by every level */
+  TextureHandle m_background;
+  std::vector<TextureHandle> m_powerup_textures;
+  std::vector<TextureHandle> m_common_textures;
+  std::vector<TextureHandle> m_prefetch;
+
+  std::vector<std::string> m_changed_files;
 
   float m_shake_time = 0;
+  /* Effects are part of the game state, the post-processor only draws them */
+  bool m_effects[PostProcessor::EFFECTS_COUNT] = {false};
 
   GameState m_state;
   uint32_t m_width, m_height;
@@ -0,0 +1,30 @@
+#ifndef YU_FILE_WATCHER_H
+#define YU_FILE_WATCHER_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* Reports files written to a set of watched directories, used to hot reload
+ * resources. Backed by inotify, on other platforms or without
+ * BREAKOUT_HOT_RELOAD nothing is ever reported */
+class FileWatcher {
+public:
+  FileWatcher() {}
+  FileWatcher(const FileWatcher &) = delete;
+  FileWatcher(FileWatcher &&) = delete;
+  FileWatcher &operator=(const FileWatcher &) = delete;
+  FileWatcher &operator=(FileWatcher &&) = delete;
+  ~FileWatcher();
+
+  bool watch(const char *directory);
+  /* Appends "<directory>/<name>" of every file changed since the last call,
+   * each at most once. Never blocks */
+  void poll(std::vector<std::string> &changed);
+
+private:
+  int m_fd = -1;
+  std::unordered_map<int, std::string> m_directories;
+};
+
+#endif /* !YU_FILE_WATCHER_H */
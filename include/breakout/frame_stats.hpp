@@ -0,0 +1,29 @@
+#ifndef YU_FRAME_STATS_H
+#define YU_FRAME_STATS_H
+
+#include <cstddef>
+#include <vector>
+
+/* Collects frame time samples (in milliseconds) and summarizes them */
+class FrameStats {
+public:
+  FrameStats() {}
+
+  void reserve(size_t count);
+  void add(double milliseconds);
+  void clear();
+
+  size_t count() const;
+  double average() const;
+  double min() const;
+  double max() const;
+  /* `p` is in range [0, 100] */
+  double percentile(double p) const;
+
+private:
+  std::vector<double> m_samples;
+  /* Scratch space for percentile(), kept to not allocate on every call */
+  mutable std::vector<double> m_sorted;
+};
+
+#endif /* !YU_FRAME_STATS_H */
@@ -14,6 +14,12 @@ class GameLevel {
 public:
   using TileData = std::vector<std::vector<uint32_t>>;
 
+  /* Resolved by the caller, so that levels can be loaded on any thread */
+  struct Sprites {
+    TextureHandle block;
+    TextureHandle block_solid;
+  };
+
 public:
   GameLevel(){};
   GameLevel(const GameLevel &) = default;
@@ -23,17 +29,26 @@ public:
   ~GameLevel(){};
 
   void load(const char *path, uint32_t window_height, uint32_t level_width,
-            uint32_t level_height);
+            uint32_t level_height, const Sprites &sprites);
+  /* Same as `load`, from the level file's contents */
+  void load_from_buffer(const char *data, size_t size, uint32_t window_height,
+                        uint32_t level_width, uint32_t level_height,
+                        const Sprites &sprites);
   void draw(SpriteRenderer &renderer);
   bool is_completed() const;
+  /* Bricks left to destroy, solid ones don't count */
+  size_t bricks_remaining() const;
   std::vector<GameObject> &bricks();
+  /* Textures the level's bricks are drawn with */
+  const std::vector<TextureHandle> &textures() const { return m_textures; }
 
 private:
   void init(TileData tile_data, uint32_t window_height, uint32_t level_width,
-            uint32_t level_height);
+            uint32_t level_height, const Sprites &sprites);
 
 private:
   std::vector<GameObject> m_bricks;
+  std::vector<TextureHandle> m_textures;
 };
 
 #endif /* !YU_GAMELEVEL_H */
@@ -4,9 +4,7 @@
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 
-#include <memory>
-
-#include "breakout/texture2d.hpp"
+#include "breakout/texture_handle.hpp"
 
 class SpriteRenderer;
 
@@ -18,7 +16,7 @@ public:
   GameObject(GameObject &&) = default;
   GameObject &operator=(const GameObject &) = default;
   GameObject &operator=(GameObject &&) = default;
-  GameObject(glm::vec2 pos, glm::vec2 size, std::shared_ptr<Texture2D> sprite,
+  GameObject(glm::vec2 pos, glm::vec2 size, TextureHandle sprite,
              glm::vec3 color = glm::vec3(1.0f),
              glm::vec2 velocity = glm::vec2(0.0f, 0.0f));
   virtual ~GameObject() {}
@@ -36,7 +34,7 @@ public:
   bool is_destroyed;
 
 protected:
-  std::shared_ptr<Texture2D> m_sprite;
+  TextureHandle m_sprite;
 };
 
 #endif /* !YU_GAMEOBJECT_H */
@@ -0,0 +1,91 @@
+#ifndef YU_GPU_TIMER_H
+#define YU_GPU_TIMER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "breakout/profiler.hpp"
+
+/* Times render passes on the GPU and records them into the profiler's
+ * "GPU" track, next to the CPU zones that issued them */
+#ifdef BREAKOUT_PROFILER
+
+#define PROFILE_GPU_SCOPE(timer, name)                                         \
+  ::Profiler::GpuZone YU_PROFILE_CONCAT(profile_gpu_zone_, __LINE__)(timer,    \
+                                                                     name)
+
+namespace Profiler {
+
+/* Every zone is a pair of timestamp queries, which unlike GL_TIME_ELAPSED
+ * may nest and overlap other timer queries. Queries are double-buffered:
+ * a frame's results are read back while the next frame is recorded, and
+ * dropped rather than waited for if the GPU is still behind */
+class GpuTimer {
+public:
+  static constexpr size_t FRAME_LATENCY = 2;
+  static constexpr size_t MAX_ZONES = 16;
+  static constexpr uint32_t INVALID_ZONE = UINT32_MAX;
+
+public:
+  GpuTimer();
+  ~GpuTimer();
+  GpuTimer(const GpuTimer &) = delete;
+  GpuTimer(GpuTimer &&) = delete;
+  GpuTimer &operator=(const GpuTimer &) = delete;
+  GpuTimer &operator=(GpuTimer &&) = delete;
+
+  /* Collects the frame recorded FRAME_LATENCY frames ago and reuses its
+   * queries */
+  void begin_frame();
+
+  uint32_t begin(const char *name);
+  void end(uint32_t zone);
+
+  /* Frames whose results weren't ready in time */
+  size_t dropped_frames() const { return m_dropped_frames; }
+
+private:
+  struct Frame {
+    uint32_t begin_queries[MAX_ZONES];
+    uint32_t end_queries[MAX_ZONES];
+    const char *names[MAX_ZONES];
+    uint32_t zone_count = 0;
+    /* The query issued last, results become available in issue order */
+    uint32_t last_query = 0;
+  };
+
+  void collect(Frame &frame);
+
+private:
+  Track *m_track;
+  Frame m_frames[FRAME_LATENCY];
+  size_t m_frame = 0;
+  /* Added to GPU timestamps to get profiler time */
+  int64_t m_clock_offset = 0;
+  size_t m_dropped_frames = 0;
+};
+
+class GpuZone {
+public:
+  GpuZone(GpuTimer &timer, const char *name)
+      : m_timer(timer), m_zone(timer.begin(name)) {}
+  ~GpuZone() { m_timer.end(m_zone); }
+  GpuZone(const GpuZone &) = delete;
+  GpuZone(GpuZone &&) = delete;
+  GpuZone &operator=(const GpuZone &) = delete;
+  GpuZone &operator=(GpuZone &&) = delete;
+
+private:
+  GpuTimer &m_timer;
+  uint32_t m_zone;
+};
+
+} // namespace Profiler
+
+#else
+
+#define PROFILE_GPU_SCOPE(timer, name)
+
+#endif /* BREAKOUT_PROFILER */
+
+#endif /* !YU_GPU_TIMER_H */
@@ -0,0 +1,26 @@
+#ifndef YU_HASH_H
+#define YU_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Hash {
+
+constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+constexpr uint64_t FNV_PRIME = 0x100000001b3ull;
+
+/* 64-bit FNV-1a, pass a previous result as `seed` to hash several blocks */
+inline uint64_t fnv1a(const void *data, size_t size,
+                      uint64_t seed = FNV_OFFSET_BASIS) {
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  uint64_t hash = seed;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
+
+} // namespace Hash
+
+#endif /* !YU_HASH_H */
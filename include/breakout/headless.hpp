@@ -0,0 +1,60 @@
+#ifndef YU_HEADLESS_H
+#define YU_HEADLESS_H
+
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+#include "breakout/keys.hpp"
+
+struct GLFWwindow;
+class BreakoutGame;
+
+namespace Headless {
+
+struct Options {
+  uint32_t frames = 600;
+  /* Recorded session to replay, see SessionRecorder */
+  const char *session_path = nullptr;
+  /* Directory to dump every rendered frame to as PPM images */
+  const char *dump_dir = nullptr;
+};
+
+/* A key event recorded `time` seconds after the session started */
+struct SessionEvent {
+  double time;
+  KeyCode key;
+  bool pressed;
+};
+
+class SessionRecorder {
+public:
+  SessionRecorder() {}
+  SessionRecorder(const SessionRecorder &) = delete;
+  SessionRecorder(SessionRecorder &&) = delete;
+  SessionRecorder &operator=(const SessionRecorder &) = delete;
+  SessionRecorder &operator=(SessionRecorder &&) = delete;
+
+  bool open(const char *path, double start_time);
+  void record(double time, KeyCode key, bool pressed);
+  bool is_open() const { return m_file.is_open(); }
+
+private:
+  std::ofstream m_file;
+  double m_start_time = 0.0;
+};
+
+std::vector<SessionEvent> load_session(const char *path);
+
+/* Render `options.frames` frames at a fixed time step into the current
+ * (offscreen) context and print CPU/GPU frame time percentiles */
+int run(GLFWwindow *window, BreakoutGame &game, const Options &options);
+
+/* Mix `options.frames` frames of audio on the offline backend while every
+ * voice the mixer allows is kept busy with sound effects, and print the
+ * mixing CPU time per simulated second. Needs neither a context nor a device */
+int run_audio_benchmark(const Options &options);
+
+} // namespace Headless
+
+#endif /* !YU_HEADLESS_H */
@@ -2,14 +2,27 @@
 #define YU_INPUT_H
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
 
 #include "breakout/keys.hpp"
 
+/* Keyboard and mouse state of one game instance, fed either from the window
+ * or programmatically (session replays, autopilots, batch simulations) */
 class Input {
 public:
   struct Key {
     bool pressed;
     bool processed;
+    /* `apply_events` call that last pressed the key */
+    uint32_t pressed_in;
+  };
+
+  /* A key event that happened `time` seconds into the session (glfwGetTime) */
+  struct Event {
+    double time;
+    KeyCode key;
+    bool pressed;
   };
 
   static constexpr size_t KEYS_COUNT =
@@ -17,34 +30,58 @@ public:
   static constexpr size_t MOUSE_BUTTON_COUNT =
       static_cast<size_t>(MouseButtonCode::MOUSE_BUTTON_LAST) + 1;
 
+  /* Events that can wait for their tick */
+  static constexpr size_t EVENT_CAPACITY = 256;
+
   using KeyArray = std::array<Key, KEYS_COUNT>;
+  using EventArray = std::array<Event, EVENT_CAPACITY>;
   using MouseArray = std::array<bool, MOUSE_BUTTON_COUNT>;
 
 public:
-  Input() = delete;
+  Input() {}
   Input(const Input &) = delete;
   Input(Input &&) = delete;
   Input &operator=(const Input &) = delete;
   Input &operator=(Input &&) = delete;
 
-  static bool is_key_pressed(const KeyCode key_code);
-  static void press_key(const KeyCode key_code);
-  static void release_key(const KeyCode key_code);
+  bool is_key_pressed(const KeyCode key_code) const;
+  void press_key(const KeyCode key_code);
+  void release_key(const KeyCode key_code);
+
+  bool is_key_processed(const KeyCode key_code) const;
+  void key_unset_proccessed(const KeyCode key_code);
+  void key_unset_proccessed_all();
 
-  static bool is_key_processed(const KeyCode key_code);
-  static void key_unset_proccessed(const KeyCode key_code);
-  static void key_unset_proccessed_all();
+  /* Queue an event for the tick it belongs to. A full queue applies its
+   * oldest event early rather than losing it */
+  void push_event(double time, const KeyCode key_code, bool pressed);
+  /* Apply, in order, the queued events that happened up to `time`. A key
+   * released in the same tick it was pressed stays down until the next one,
+   * so that a quick tap is never lost */
+  void apply_events(double time);
+  /* Time of the oldest event applied since the last call, returns false if
+   * none was. Used to measure input latency */
+  bool pop_applied_time(double &time);
+  /* Whether events are queued that no tick has applied yet */
+  bool has_pending_events() const { return m_event_count > 0; }
 
-  static bool is_mouse_button_pressed(const MouseButtonCode mb_code);
-  static void press_mouse_button(const MouseButtonCode mb_code);
-  static void release_mouse_button(const MouseButtonCode mb_code);
+  bool is_mouse_button_pressed(const MouseButtonCode mb_code) const;
+  void press_mouse_button(const MouseButtonCode mb_code);
+  void release_mouse_button(const MouseButtonCode mb_code);
 
 private:
   static bool key_is_safe(const KeyCode key_code);
 
 private:
-  static KeyArray m_keys;
-  static MouseArray m_mouse;
-}; // namespace Input
+  KeyArray m_keys = {};
+  MouseArray m_mouse = {};
+
+  EventArray m_events;
+  size_t m_event_head = 0;
+  size_t m_event_count = 0;
+  uint32_t m_apply_count = 0;
+  double m_applied_time = 0.0;
+  bool m_has_applied_time = false;
+};
 
 #endif // !YU_INPUT_H
@@ -1,10 +1,110 @@
 #ifndef YU_MEMORY_H
 #define YU_MEMORY_H
 
-#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace Memory {
-std::string read_file(const std::string &filepath);
+/* Create a directory, succeeds if it already exists */
+bool create_directory(const char *path);
+
+/* Heap allocations made through the global operator new, which this module
+ * replaces to count them */
+struct AllocationCount {
+  uint64_t allocations = 0;
+  uint64_t bytes = 0;
+};
+
+/* What the calling thread has allocated since it started */
+AllocationCount thread_allocations();
+
+/* Stores the number of allocations the calling thread makes during the
+ * scope's lifetime in `count` */
+class AllocationScope {
+public:
+  explicit AllocationScope(uint64_t &count)
+      : m_count(count), m_start(thread_allocations().allocations) {}
+  AllocationScope(const AllocationScope &) = delete;
+  AllocationScope(AllocationScope &&) = delete;
+  AllocationScope &operator=(const AllocationScope &) = delete;
+  AllocationScope &operator=(AllocationScope &&) = delete;
+  ~AllocationScope() {
+    m_count = thread_allocations().allocations - m_start;
+  }
+
+private:
+  uint64_t &m_count;
+  uint64_t m_start;
+};
+
+/* Non-owning view of a file's contents. Views handed out by MappedFile and
+ * ResourcePack are followed by a NUL byte, so text files can be used as C
+ * strings in place */
+struct FileView {
+  const unsigned char *data = nullptr;
+  size_t size = 0;
+
+  /* An empty view reads as an empty string */
+  const char *text() const {
+    return data ? reinterpret_cast<const char *>(data) : "";
+  }
+  bool empty() const { return data == nullptr; }
+};
+
+/* Linear allocator for short-lived buffers, released all at once by reset()
+ * or on destruction. allocate() is thread-safe */
+class Arena {
+public:
+  explicit Arena(size_t block_size = 64 * 1024) : m_block_size(block_size) {}
+  Arena(const Arena &) = delete;
+  Arena(Arena &&) = delete;
+  Arena &operator=(const Arena &) = delete;
+  Arena &operator=(Arena &&) = delete;
+
+  void *allocate(size_t size, size_t alignment = 16);
+  void reset();
+
+private:
+  struct Block {
+    std::unique_ptr<unsigned char[]> data;
+    size_t capacity;
+  };
+
+  std::mutex m_mutex;
+  std::vector<Block> m_blocks;
+  size_t m_used = 0;
+  size_t m_block_size;
+};
+
+/* Read-only view of a whole file, memory-mapped where supported. If the file
+ * can't be mapped it is read into `arena` when given, otherwise into a buffer
+ * owned by the MappedFile */
+class MappedFile {
+public:
+  MappedFile() {}
+  MappedFile(const MappedFile &) = delete;
+  MappedFile(MappedFile &&) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile &operator=(MappedFile &&) = delete;
+  ~MappedFile();
+
+  bool open(const char *path, Arena *arena = nullptr);
+  void close();
+
+  const unsigned char *data() const { return m_view.data; }
+  size_t size() const { return m_view.size; }
+  const FileView &view() const { return m_view; }
+  bool is_open() const { return !m_view.empty(); }
+
+private:
+  FileView m_view;
+  /* Length of the mapping, which extends past the end of the file */
+  size_t m_mapped_size = 0;
+  std::vector<unsigned char> m_buffer;
+};
 } // namespace Memory
 
 #endif /* !YU_MEMORY_H */
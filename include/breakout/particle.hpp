@@ -6,10 +6,13 @@
 
 #include <cstdint>
 #include <memory>
+#include <random>
 #include <vector>
 
+#include "breakout/render_stats.hpp"
+#include "breakout/texture_handle.hpp"
+
 class Shader;
-class Texture2D;
 class GameObject;
 
 struct Particle {
@@ -26,11 +29,18 @@ public:
   ParticleGenerator &operator=(const ParticleGenerator &) = delete;
   ParticleGenerator &operator=(ParticleGenerator &&) = delete;
   ParticleGenerator(std::shared_ptr<Shader> shader,
-                    std::shared_ptr<Texture2D> texture, size_t amount);
+                    TextureHandle texture, size_t amount);
   ~ParticleGenerator();
   void update(float dt, GameObject &object, size_t new_particles,
               glm::vec2 offset = glm::vec2(0.0f));
   void draw() const;
+  /* Particles are scattered with the generator's own engine, so they don't
+   * take numbers from the game's simulation */
+  void seed(uint32_t seed) { m_random.seed(seed); }
+
+  size_t live_particles() const;
+  const RenderStats &stats() const { return m_stats; }
+  void reset_stats() { m_stats = RenderStats(); }
 
 private:
   void init();
@@ -41,12 +51,15 @@ private:
 private:
   std::vector<Particle> m_particles;
   size_t m_num_particles;
+  std::minstd_rand m_random;
 
   std::shared_ptr<Shader> m_shader;
-  std::shared_ptr<Texture2D> m_texture;
+  TextureHandle m_texture;
 
   uint32_t m_vao;
   uint32_t m_vbo;
+  /* Drawing doesn't change the particles, only what was submitted */
+  mutable RenderStats m_stats;
 };
 
 #endif /* !YU_PARTICLE_H */
@@ -4,6 +4,7 @@
 #include <memory>
 #include <cstdint>
 
+#include "breakout/render_stats.hpp"
 #include "breakout/texture2d.hpp"
 
 class Shader;
@@ -36,6 +37,9 @@ public:
 
   bool is_effect_enabled(Effect effect) const;
 
+  const RenderStats &stats() const { return m_stats; }
+  void reset_stats() { m_stats = RenderStats(); }
+
 private:
   void init_render_data();
   bool &get_effect_field(Effect effect);
@@ -50,6 +54,7 @@ private:
   uint32_t m_msfbo, m_fbo;
   uint32_t m_rbo;
   uint32_t m_vao;
+  RenderStats m_stats;
 };
 
 #endif /* !YU_POSTPROCESSOR_H */
@@ -1,12 +1,8 @@
 #ifndef YU_POWERUP_H
 #define YU_POWERUP_H
 
-#include <memory>
-
 #include "breakout/gameobject.hpp"
 
-class Texture2D;
-
 enum class PowerUpType {
   SPEED,
   STICKY,
@@ -27,7 +23,7 @@ public:
   PowerUp &operator=(const PowerUp &) = default;
   PowerUp &operator=(PowerUp &&) = default;
   PowerUp(PowerUpType type, glm::vec3 color, float duration, glm::vec2 pos,
-          std::shared_ptr<Texture2D> texture);
+          TextureHandle texture);
   void set_activated(bool is_powerup_activated) {
     m_activated = is_powerup_activated;
   }
@@ -0,0 +1,67 @@
+#ifndef YU_PROFILER_H
+#define YU_PROFILER_H
+
+#include <cstdint>
+
+/* Scoped CPU timing zones, recorded only when built with BREAKOUT_PROFILER.
+ * Zones nest by time, so a zone opened inside another one shows up as its
+ * child in the exported trace */
+#ifdef BREAKOUT_PROFILER
+
+#define YU_PROFILE_CONCAT_IMPL(a, b) a##b
+#define YU_PROFILE_CONCAT(a, b) YU_PROFILE_CONCAT_IMPL(a, b)
+
+/* `name` must outlive the trace export, i.e. be a string literal */
+#define PROFILE_SCOPE(name)                                                    \
+  ::Profiler::Zone YU_PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+
+namespace Profiler {
+
+/* Every thread keeps the most recent zones it recorded in its own ring, so
+ * recording never locks and a capture covers the last few seconds */
+constexpr uint32_t EVENT_CAPACITY = 1 << 15;
+
+/* A timeline in exported traces, either a thread or a named track */
+struct Track;
+
+/* Nanoseconds since the profiler's epoch */
+uint64_t now();
+
+/* Append a finished zone to the calling thread's ring */
+void record(const char *name, uint64_t start, uint64_t end);
+
+/* Tracks hold zones that weren't timed on a CPU thread, e.g. GPU passes.
+ * Only one thread at a time may record into a track */
+Track *create_track(const char *name);
+void record(Track *track, const char *name, uint64_t start, uint64_t end);
+
+/* Label the calling thread in exported traces, `name` must be static */
+void set_thread_name(const char *name);
+
+/* Write the zones recorded so far by all threads in Chrome's trace event
+ * format, which chrome://tracing and Perfetto load directly */
+bool write_trace(const char *path);
+
+class Zone {
+public:
+  explicit Zone(const char *name) : m_name(name), m_start(now()) {}
+  ~Zone() { record(m_name, m_start, now()); }
+  Zone(const Zone &) = delete;
+  Zone(Zone &&) = delete;
+  Zone &operator=(const Zone &) = delete;
+  Zone &operator=(Zone &&) = delete;
+
+private:
+  const char *m_name;
+  uint64_t m_start;
+};
+
+} // namespace Profiler
+
+#else
+
+#define PROFILE_SCOPE(name)
+
+#endif /* BREAKOUT_PROFILER */
+
+#endif /* !YU_PROFILER_H */
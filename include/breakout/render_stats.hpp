@@ -0,0 +1,22 @@
+#ifndef YU_RENDER_STATS_H
+#define YU_RENDER_STATS_H
+
+#include <cstdint>
+
+/* What a renderer submitted to OpenGL since its counters were reset */
+struct RenderStats {
+  uint32_t draw_calls = 0;
+  /* Programs, texture units, textures, buffers, vertex arrays and
+   * framebuffers bound, and blend function changes */
+  uint32_t state_changes = 0;
+  uint32_t vertices = 0;
+
+  RenderStats &operator+=(const RenderStats &other) {
+    draw_calls += other.draw_calls;
+    state_changes += other.state_changes;
+    vertices += other.vertices;
+    return *this;
+  }
+};
+
+#endif /* !YU_RENDER_STATS_H */
@@ -3,31 +3,80 @@
 
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 #include <memory>
 
-class Texture2D;
+#include "breakout/file_watcher.hpp"
+#include "breakout/texture2d.hpp"
+#include "breakout/texture_cache.hpp"
+#include "breakout/texture_handle.hpp"
+#include "breakout/worker_pool.hpp"
+
 class Shader;
 
+/* Registry of shaders and textures. The static API works on the registry
+ * bound to the calling thread by a Scope, or on a process-wide default one,
+ * so independent games can each bring their own */
 class ResourceManager {
 public:
   using ShaderMap = std::unordered_map<std::string, std::shared_ptr<Shader>>;
-  using TextureMap =
-      std::unordered_map<std::string, std::shared_ptr<Texture2D>>;
+  using TextureNameMap = std::unordered_map<std::string, TextureHandle>;
+
+  /* GPU memory textures may take before least recently used ones are
+   * evicted */
+  static constexpr size_t DEFAULT_TEXTURE_BUDGET = 256 * 1024 * 1024;
+  /* Frames a texture has to go unused before it may be evicted, so that one
+   * drawn every now and then isn't reloaded each time */
+  static constexpr uint64_t TEXTURE_EVICTION_AGE = 120;
+
+  struct TextureInfo {
+    const char *name;
+    const char *filename;
+    bool alpha;
+    bool mipmaps = true;
+  };
+
+  /* Binds a registry to the calling thread for its lifetime */
+  class Scope {
+  public:
+    explicit Scope(ResourceManager &manager) : m_previous(m_current) {
+      m_current = &manager;
+    }
+    Scope(const Scope &) = delete;
+    Scope(Scope &&) = delete;
+    Scope &operator=(const Scope &) = delete;
+    Scope &operator=(Scope &&) = delete;
+    ~Scope() { m_current = m_previous; }
+
+  private:
+    ResourceManager *m_previous;
+  };
 
 public:
+  ResourceManager() {}
   ResourceManager(const ResourceManager &) = delete;
   ResourceManager(ResourceManager &&) = delete;
   ResourceManager &operator=(const ResourceManager &) = delete;
   ResourceManager &operator=(ResourceManager &&) = delete;
 
+  /* Register the game's textures by name without touching the GPU, enough
+   * for a simulation that doesn't render */
+  static void register_resources() {
+    return ResourceManager::get().register_resources_impl();
+  }
+  /* Register the game's textures and build its shaders */
   static void load_resources() {
     return ResourceManager::get().load_resources_impl();
   }
-  static ResourceManager &get() {
+  /* The process-wide registry, used by threads without a Scope */
+  static ResourceManager &global() {
     static ResourceManager rmanager;
     return rmanager;
-  };
+  }
+  static ResourceManager &get() {
+    return m_current != nullptr ? *m_current : global();
+  }
 
   static std::shared_ptr<Shader> load_shader(const char *name,
                                              const char *vert_path,
@@ -39,35 +88,128 @@ public:
   static std::shared_ptr<Shader> shader(const char *name) {
     return ResourceManager::get().shader_impl(name);
   }
-  static std::shared_ptr<Texture2D> texture(const char *name) {
-    return ResourceManager::get().texture_impl(name);
+  /* Look textures up by name once and keep the handle around */
+  static TextureHandle texture_handle(const char *name) {
+    return ResourceManager::get().texture_handle_impl(name);
+  }
+  /* Returns nullptr if the handle is invalid or stale. Textures that aren't
+   * resident are loaded on the spot */
+  static Texture2D *texture(TextureHandle handle) {
+    return ResourceManager::get().texture_impl(handle);
+  }
+  /* Make textures known by name without loading them, they are loaded on
+   * first use or by `prefetch_textures` */
+  static void register_textures(const std::vector<TextureInfo> &infos) {
+    return ResourceManager::get().register_textures_impl(infos);
   }
-  static std::shared_ptr<Texture2D> load_texture(const char *name,
-                                                 const char *path, bool alpha) {
+  /* Load all of `handles` that aren't resident in one batch. They aren't
+   * evicted before their first use or `unpin_textures` */
+  static void prefetch_textures(const std::vector<TextureHandle> &handles) {
+    return ResourceManager::get().prefetch_textures_impl(handles);
+  }
+  /* Let prefetched textures that were never used be evicted again, e.g.
+   * when the level they were fetched for is left */
+  static void unpin_textures() {
+    return ResourceManager::get().unpin_textures_impl();
+  }
+  /* 0 disables eviction */
+  static void set_texture_budget(size_t bytes) {
+    ResourceManager::get().m_texture_budget = bytes;
+  }
+  /* Call once per rendered frame. Evicts the least recently used textures,
+   * other than pinned ones and those used within `TEXTURE_EVICTION_AGE`
+   * frames, while over budget. Writes back the texel cache if it changed */
+  static void end_frame() { return ResourceManager::get().end_frame_impl(); }
+  /* Replaces the texture in place if `name` is already loaded, so handles
+   * to it stay valid */
+  static TextureHandle load_texture(const char *name, const char *path,
+                                    bool alpha) {
     return ResourceManager::get().load_texture_impl(name, path, alpha);
   }
+  /* Decode textures in parallel and upload them in one batch */
+  static void load_textures(const std::vector<TextureInfo> &infos) {
+    return ResourceManager::get().load_textures_impl(infos);
+  }
+  /* Start watching the loose files under res/ for changes */
+  static void watch_resources() {
+    return ResourceManager::get().watch_resources_impl();
+  }
+  /* Reloads changed textures, starts rebuilding changed shaders and swaps in
+   * those that are done. Paths of other changed files (e.g. levels) are
+   * appended to `changed`. Returns true if any resource was replaced */
+  static bool poll_hot_reload(std::vector<std::string> &changed) {
+    return ResourceManager::get().poll_hot_reload_impl(changed);
+  }
   static void clear() { return ResourceManager::get().clear_impl(); }
+  /* Estimated GPU memory used by all textures, in bytes */
+  static size_t texture_memory_usage() {
+    return ResourceManager::get().texture_memory_usage_impl();
+  }
 
 private:
-  ResourceManager() {}
-
+  void register_resources_impl();
   void load_resources_impl();
   std::shared_ptr<Shader> load_shader_impl(const char *name,
                                            const char *vert_path,
                                            const char *frag_path,
                                            const char *geom_path = nullptr);
   std::shared_ptr<Shader> shader_impl(const char *name);
-  std::shared_ptr<Texture2D> texture_impl(const char *name);
-  std::shared_ptr<Texture2D> load_texture_impl(const char *name,
-                                               const char *path, bool alpha);
+  TextureHandle texture_handle_impl(const char *name) const;
+  Texture2D *texture_impl(TextureHandle handle);
+  TextureHandle load_texture_impl(const char *name, const char *path,
+                                  bool alpha);
+  void load_textures_impl(const std::vector<TextureInfo> &infos);
+  void register_textures_impl(const std::vector<TextureInfo> &infos);
+  void prefetch_textures_impl(const std::vector<TextureHandle> &handles);
+  void unpin_textures_impl();
+  void end_frame_impl();
   void clear_impl();
+  size_t texture_memory_usage_impl() const;
+  void watch_resources_impl();
+  bool poll_hot_reload_impl(std::vector<std::string> &changed);
 
-  std::shared_ptr<Texture2D> load_texture_from_file(const char *file,
-                                                    bool alpha);
+  Texture2D load_texture_from_file(const char *file, bool alpha);
+  TextureHandle register_texture(const TextureInfo &info);
+  void set_texture(uint16_t index, Texture2D &&texture);
+  void evict_texture(uint16_t index);
 
 private:
+  static thread_local ResourceManager *m_current;
+
+  /* Where resources were loaded from, for hot reloading */
+  struct ShaderSources {
+    std::string vertex, fragment, geometry;
+  };
+  struct TextureSource {
+    std::string name;
+    std::string filename;
+    bool alpha;
+    bool mipmaps;
+  };
+
   ShaderMap m_shaders;
-  TextureMap m_textures;
+  std::unordered_map<std::string, ShaderSources> m_shader_sources;
+  FileWatcher m_watcher;
+  std::vector<std::string> m_changed_files;
+
+  /* Dense texture storage, the vectors below are parallel to `m_textures`.
+   * `m_texture_generations` outlives clear() so that handles issued before
+   * are detected as stale */
+  std::vector<Texture2D> m_textures;
+  std::vector<TextureSource> m_texture_sources;
+  std::vector<uint16_t> m_texture_generations;
+  std::vector<uint8_t> m_texture_resident;
+  std::vector<uint64_t> m_texture_last_used;
+  std::vector<uint8_t> m_texture_pinned;
+  std::vector<uint16_t> m_eviction_candidates;
+  TextureNameMap m_texture_names;
+  TextureCache m_texture_cache;
+  /* Decodes batches of textures, started on the first batch */
+  std::unique_ptr<WorkerPool> m_decode_pool;
+
+  uint64_t m_frame = 0;
+  size_t m_texture_budget = DEFAULT_TEXTURE_BUDGET;
+  size_t m_texture_memory = 0;
 };
 
 #endif /* !YU_RESOURCE_MANAGER_H */
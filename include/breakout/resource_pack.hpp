@@ -0,0 +1,87 @@
+#ifndef YU_RESOURCE_PACK_H
+#define YU_RESOURCE_PACK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "breakout/memory.hpp"
+
+/* Read-only archive of every asset under res/, built by `packbuilder`.
+ *
+ * The archive is memory-mapped and looked up by path through a hashed index,
+ * so loaders read straight from the mapping. Identical files share their
+ * data and every blob is followed by a NUL byte, so text assets can be used
+ * as C strings in place */
+class ResourcePack {
+public:
+  struct Entry {
+    const char *path;
+    const unsigned char *data;
+    size_t size;
+  };
+
+  /* On-disk layout, shared with the pack builder */
+  static constexpr char MAGIC[4] = {'B', 'K', 'P', 'K'};
+  static constexpr uint32_t VERSION = 1;
+  static constexpr size_t DATA_ALIGNMENT = 16;
+
+  struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+  };
+
+  /* Records are sorted by `path_hash` */
+  struct Record {
+    uint64_t path_hash;
+    uint64_t path_offset;
+    uint64_t data_offset;
+    uint64_t data_size;
+  };
+
+public:
+  ResourcePack(const ResourcePack &) = delete;
+  ResourcePack(ResourcePack &&) = delete;
+  ResourcePack &operator=(const ResourcePack &) = delete;
+  ResourcePack &operator=(ResourcePack &&) = delete;
+
+  static ResourcePack &get() {
+    static ResourcePack pack;
+    return pack;
+  }
+
+  static bool mount(const char *path) {
+    return ResourcePack::get().mount_impl(path);
+  }
+  static void unmount() { return ResourcePack::get().unmount_impl(); }
+  static bool is_mounted() { return ResourcePack::get().m_file.is_open(); }
+
+  /* Returns nullptr if no pack is mounted or it doesn't contain `path` */
+  static const Entry *find(const char *path) {
+    return ResourcePack::get().find_impl(path);
+  }
+  /* Contents of `path` from the pack, or mapped from disk into `file` if the
+   * pack doesn't have it. Empty if neither has it */
+  static Memory::FileView open(const char *path, Memory::MappedFile &file,
+                               Memory::Arena *arena = nullptr);
+  static const std::vector<Entry> &entries() {
+    return ResourcePack::get().m_entries;
+  }
+
+private:
+  ResourcePack() {}
+
+  bool mount_impl(const char *path);
+  void unmount_impl();
+  const Entry *find_impl(const char *path) const;
+
+private:
+  Memory::MappedFile m_file;
+  /* Parallel to the records in the index */
+  std::vector<uint64_t> m_hashes;
+  std::vector<Entry> m_entries;
+};
+
+#endif /* !YU_RESOURCE_PACK_H */
@@ -6,11 +6,17 @@
 #include <glm/mat4x4.hpp>
 
 #include <string>
-#include <unordered_map>
+#include <vector>
 
 class Shader {
 public:
-  using LocationCacheMap = std::unordered_map<std::string, int>;
+  /* A program has a handful of uniforms, so a scan compared with strcmp is
+   * as quick as hashing and doesn't have to build a std::string per lookup */
+  struct CachedLocation {
+    std::string name;
+    int32_t location;
+  };
+  using LocationCache = std::vector<CachedLocation>;
 
   Shader(const char *vertex_source, const char *fragment_source,
          const char *geometry_source = nullptr);
@@ -24,6 +30,18 @@ public:
   void bind() const;
   void unbind() const;
   uint32_t id() const;
+
+  /* Compile and link a new program without waiting for the driver. The
+   * current program stays in use until `poll_rebuild` swaps the new one in */
+  void rebuild(const char *vertex_source, const char *fragment_source,
+               const char *geometry_source = nullptr);
+  /* Swaps in the rebuilt program once it's linked, carrying over uniform
+   * values. A program that fails to build is dropped and the current one is
+   * kept. Returns true if the program was swapped. Never waits with
+   * KHR_parallel_shader_compile, without it the second call may block until
+   * the link is done */
+  bool poll_rebuild();
+  bool is_rebuilding() const { return m_pending_id != 0; }
   /* utility uniform functions */
   void setb(const char *name, const uint8_t value);
   void seti(const char *name, const int32_t value);
@@ -39,13 +57,22 @@ public:
   void setmat3f(const char *name, const glm::mat3 &mat);
   void setmat4f(const char *name, const glm::mat4 &mat);
 
+  /* Location of the uniform `name`, looked up once and then cached */
+  int32_t find_uniform(const char *name);
+
 private:
   uint32_t compile_shader(uint32_t e_shader_type, const char *source) const;
-  int32_t find_uniform(const char *name);
+  void discard_rebuild();
 
 private:
   uint32_t m_id;
-  LocationCacheMap m_location_cache;
+  LocationCache m_location_cache;
+
+  /* Program being rebuilt in the background */
+  uint32_t m_pending_id = 0;
+  std::vector<uint32_t> m_pending_shaders;
+  uint64_t m_pending_key = 0;
+  uint32_t m_pending_polls = 0;
 };
 
 #endif /* !YU_SHADER_H */
@@ -3,10 +3,13 @@
 
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
 
 #include <cstdint>
 #include <memory>
 
+#include "breakout/render_stats.hpp"
+
 class Texture2D;
 class Shader;
 
@@ -23,6 +26,14 @@ public:
             glm::vec2 size = glm::vec2(10.0f, 10.0f), float rotate = 0.0f,
             glm::vec3 color = glm::vec3(1.0f));
 
+  /* Transform of the unit quad onto the sprite's rectangle, rotated by
+   * `rotate` degrees around its center */
+  static glm::mat4 model_matrix(glm::vec2 position, glm::vec2 size,
+                                float rotate);
+
+  const RenderStats &stats() const { return m_stats; }
+  void reset_stats() { m_stats = RenderStats(); }
+
 private:
   void init_render_data();
 
@@ -30,6 +41,7 @@ private:
   std::shared_ptr<Shader> m_shader;
   uint32_t m_quad_vao;
   uint32_t m_quad_vbo;
+  RenderStats m_stats;
 };
 
 #endif /* !YU_SPRITE_RENDERER_H */
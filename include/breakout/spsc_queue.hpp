@@ -0,0 +1,60 @@
+#ifndef YU_SPSC_QUEUE_H
+#define YU_SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+/* Bounded wait-free queue between exactly one producer thread and one
+ * consumer thread. Neither side ever locks or allocates, a full queue
+ * rejects the push instead */
+template <typename T, size_t CAPACITY> class SpscQueue {
+  static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0,
+                "SpscQueue capacity must be a power of two");
+
+public:
+  SpscQueue() {}
+  SpscQueue(const SpscQueue &) = delete;
+  SpscQueue(SpscQueue &&) = delete;
+  SpscQueue &operator=(const SpscQueue &) = delete;
+  SpscQueue &operator=(SpscQueue &&) = delete;
+
+  /* Producer only, returns false if the queue is full */
+  bool push(const T &item) {
+    const size_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_head.load(std::memory_order_acquire) == CAPACITY) {
+      return false;
+    }
+    m_items[tail & (CAPACITY - 1)] = item;
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /* Consumer only, returns false if the queue is empty */
+  bool pop(T &item) {
+    const size_t head = m_head.load(std::memory_order_relaxed);
+    if (head == m_tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = m_items[head & (CAPACITY - 1)];
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const {
+    return m_head.load(std::memory_order_acquire) ==
+           m_tail.load(std::memory_order_acquire);
+  }
+
+private:
+  static constexpr size_t CACHE_LINE_SIZE = 64;
+
+  /* Each index lives on its own cache line so that the two threads don't
+   * invalidate each other's line on every push and pop */
+  std::atomic<size_t> m_head{0};
+  char m_head_padding[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> m_tail{0};
+  char m_tail_padding[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+  T m_items[CAPACITY];
+};
+
+#endif /* !YU_SPSC_QUEUE_H */
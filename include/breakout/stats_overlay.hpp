@@ -0,0 +1,63 @@
+#ifndef YU_STATS_OVERLAY_H
+#define YU_STATS_OVERLAY_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "breakout/frame_stats.hpp"
+#include "breakout/render_stats.hpp"
+
+class TextRenderer;
+
+/* On-screen performance numbers for spotting regressions without a
+ * profiler. Frame times and the tick rate are summarized over a short
+ * window so that the text stays readable */
+class StatsOverlay {
+public:
+  static constexpr double REFRESH_INTERVAL = 0.5;
+
+  /* What the renderers and the simulation report for the last frame */
+  struct Counters {
+    RenderStats render;
+    size_t particles = 0;
+    size_t powerups = 0;
+    size_t bricks = 0;
+    size_t texture_memory = 0;
+    /* Heap allocations in the last call of each phase */
+    uint64_t input_allocations = 0;
+    uint64_t update_allocations = 0;
+    uint64_t render_allocations = 0;
+  };
+
+public:
+  StatsOverlay();
+  StatsOverlay(const StatsOverlay &) = delete;
+  StatsOverlay(StatsOverlay &&) = delete;
+  StatsOverlay &operator=(const StatsOverlay &) = delete;
+  StatsOverlay &operator=(StatsOverlay &&) = delete;
+
+  void set_visible(bool visible);
+  bool is_visible() const { return m_visible; }
+
+  /* `time` is when the frame started, in seconds */
+  void add_frame(double time);
+  void add_tick() { ++m_ticks; }
+
+  /* Lines go downwards from the baseline at `y` */
+  void draw(TextRenderer &renderer, const Counters &counters, float x,
+            float y) const;
+
+private:
+  FrameStats m_frame_times;
+  double m_last_frame = -1.0;
+  double m_window_start = -1.0;
+  uint32_t m_ticks = 0;
+
+  double m_frame_average = 0.0;
+  double m_frame_p99 = 0.0;
+  double m_tick_rate = 0.0;
+
+  bool m_visible = false;
+};
+
+#endif /* !YU_STATS_OVERLAY_H */
@@ -8,6 +8,8 @@
 #include <memory>
 #include <unordered_map>
 
+#include "breakout/render_stats.hpp"
+
 class Shader;
 
 struct TextCharacter {
@@ -33,11 +35,20 @@ public:
   void render(const char *text, float x, float y, float scale,
               glm::vec3 color = glm::vec3(1.0f));
 
+  /* Vertices (position, texture coordinates) of the triangle strip drawing
+   * `ch` with its origin at `x`, `y` */
+  static void glyph_quad(const TextCharacter &ch, float x, float y,
+                         float scale, float vertices[4][4]);
+
+  const RenderStats &stats() const { return m_stats; }
+  void reset_stats() { m_stats = RenderStats(); }
+
 private:
   CharMap m_characters;
   std::shared_ptr<Shader> m_shader;
   uint32_t m_vao;
   uint32_t m_vbo;
+  RenderStats m_stats;
 };
 
 #endif /* !YU_TEXT_RENDERER */
@@ -1,8 +1,13 @@
 #ifndef YU_TEXTURE_H
 #define YU_TEXTURE_H
 
+#include <cstddef>
 #include <cstdint>
 
+namespace BlockCompression {
+struct Image;
+} // namespace BlockCompression
+
 class Texture2D {
 public:
   Texture2D();
@@ -12,22 +17,46 @@ public:
   Texture2D &operator=(Texture2D &&);
   ~Texture2D();
 
-  void generate(uint32_t width, uint32_t height, unsigned char *data);
+  void generate(uint32_t width, uint32_t height, const unsigned char *data);
+  /* Upload from the currently bound pixel unpack buffer at `offset` */
+  void generate_from_buffer(uint32_t width, uint32_t height, size_t offset);
+  /* Block-compressed images bring their own mip chain */
+  void generate_compressed(const BlockCompression::Image &image);
+  void generate_compressed_from_buffer(const BlockCompression::Image &image,
+                                       size_t offset);
   void bind() const;
   void set_internal_format(int32_t format);
   void set_image_format(uint32_t format);
+  /* Generate a full mip chain for uncompressed images */
+  void set_mipmaps(bool mipmaps);
 
   void unbind() const;
   uint32_t id() const;
+  uint32_t width() const;
+  uint32_t height() const;
+  uint32_t levels() const;
+  /* Estimated GPU memory in bytes, including all mip levels */
+  size_t memory_usage() const;
+
+private:
+  /* Allocate immutable storage, leaves the texture bound */
+  void allocate(uint32_t width, uint32_t height, uint32_t levels,
+                uint32_t format);
+  void upload_compressed(const BlockCompression::Image &image,
+                         const unsigned char *data);
 
 private:
   uint32_t m_id;
   uint32_t m_width, m_height;
+  uint32_t m_levels;
   int32_t m_internal_format;
   uint32_t m_image_format;
 
   uint32_t m_wrap_s, m_wrap_t;
   uint32_t m_filter_min, m_filter_max;
+
+  bool m_mipmaps;
+  size_t m_memory_usage;
 };
 
 #endif /* !YU_TEXTURE_H */
@@ -0,0 +1,65 @@
+#ifndef YU_TEXTURE_CACHE_H
+#define YU_TEXTURE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "breakout/memory.hpp"
+
+/* Cache of decoded texel data keyed by the hash of the source file. The
+ * cache file is memory-mapped so cached texels are uploaded without
+ * decoding or copying them first */
+class TextureCache {
+public:
+  struct Entry {
+    uint32_t width, height;
+    uint32_t channels;
+    /* Number of mip levels stored back to back, largest first */
+    uint32_t levels;
+    const unsigned char *texels;
+    size_t size;
+  };
+
+public:
+  TextureCache() {}
+  TextureCache(const TextureCache &) = delete;
+  TextureCache(TextureCache &&) = delete;
+  TextureCache &operator=(const TextureCache &) = delete;
+  TextureCache &operator=(TextureCache &&) = delete;
+
+  static uint64_t make_key(const void *source, size_t source_size,
+                           uint32_t channels);
+
+  bool open(const char *path);
+
+  /* Safe to call from multiple threads */
+  const Entry *find(uint64_t key) const;
+
+  /* Keep a cached entry in the cache file on the next save */
+  void retain(uint64_t key);
+  /* Add new texel data, it is copied until the next save */
+  void store(uint64_t key, const Entry &entry);
+  /* Whether anything was stored since the last save */
+  bool is_dirty() const { return m_dirty; }
+
+  /* Write the retained and stored entries if anything was stored, then map
+   * the new file so that the copies can be released */
+  bool save();
+
+private:
+  bool map_entries();
+
+private:
+  std::string m_path;
+  Memory::MappedFile m_file;
+
+  std::unordered_map<uint64_t, Entry> m_entries;
+  std::unordered_map<uint64_t, bool> m_retained;
+  std::vector<std::vector<unsigned char>> m_stored_texels;
+  bool m_dirty = false;
+};
+
+#endif /* !YU_TEXTURE_CACHE_H */
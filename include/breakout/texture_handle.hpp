@@ -0,0 +1,17 @@
+#ifndef YU_TEXTURE_HANDLE_H
+#define YU_TEXTURE_HANDLE_H
+
+#include <cstdint>
+
+/* Reference to a texture owned by ResourceManager. `index` addresses its
+ * dense texture array and `generation` tells whether the slot still holds
+ * the texture the handle was issued for. Default-constructed handles are
+ * invalid */
+struct TextureHandle {
+  uint16_t index = 0;
+  uint16_t generation = 0;
+
+  bool is_valid() const { return generation != 0; }
+};
+
+#endif /* !YU_TEXTURE_HANDLE_H */
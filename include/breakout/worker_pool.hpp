@@ -0,0 +1,48 @@
+#ifndef YU_WORKER_POOL_H
+#define YU_WORKER_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Threads started once that run jobs from a shared queue, so batches of
+ * work don't pay for creating and joining threads every time */
+class WorkerPool {
+public:
+  explicit WorkerPool(size_t threads);
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool(WorkerPool &&) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+  WorkerPool &operator=(WorkerPool &&) = delete;
+  /* Waits for the queued jobs before stopping the workers */
+  ~WorkerPool();
+
+  void submit(std::function<void()> job);
+  /* Blocks until every submitted job is done, the calling thread runs
+   * queued jobs in the meantime */
+  void wait();
+  size_t size() const { return m_workers.size(); }
+
+private:
+  void run();
+  /* Call with `m_mutex` held. False if the queue is empty */
+  bool pop_job(std::function<void()> &job);
+  /* Call with `m_mutex` held */
+  void finish_job();
+
+private:
+  std::vector<std::thread> m_workers;
+  std::deque<std::function<void()>> m_jobs;
+  std::mutex m_mutex;
+  std::condition_variable m_job_added;
+  std::condition_variable m_jobs_done;
+  /* Jobs queued or running */
+  size_t m_unfinished = 0;
+  bool m_stopping = false;
+};
+
+#endif /* !YU_WORKER_POOL_H */
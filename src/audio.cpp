@@ -1,62 +1,542 @@
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+/* Streamed sounds keep two pages decoded ahead */
+#define MA_RESOURCE_MANAGER_PAGE_SIZE_IN_MILLISECONDS 500
 #define MINIAUDIO_IMPLEMENTATION
 #include <miniaudio.h>
 
 #include "breakout/audio.hpp"
 #include "breakout/log.hpp"
+#include "breakout/macro.hpp"
+#include "breakout/memory.hpp"
+#include "breakout/resource_pack.hpp"
+
+/* Voices stay bound to the PCM of their effect for their whole life, so the
+ * audio thread never sees a buffer change under it */
+struct AudioEngine::Voice {
+  ma_audio_buffer_ref buffer;
+  ma_sound sound;
+  uint8_t priority;
+  uint64_t start_time;
+};
+
+/* Streams are read through the resource manager's VFS rather than its
+ * registered data, so serve packed files to them from the mapping and leave
+ * the rest to the default VFS */
+struct AudioEngine::PackVFS {
+  struct File {
+    const ResourcePack::Entry *entry;
+    size_t cursor;
+    ma_vfs_file file;
+  };
+
+  ma_vfs_callbacks callbacks;
+  ma_default_vfs fallback;
+
+  PackVFS() {
+    ma_default_vfs_init(&fallback, nullptr);
+    callbacks.onOpen = open;
+    callbacks.onOpenW = open_w;
+    callbacks.onClose = close;
+    callbacks.onRead = read;
+    callbacks.onWrite = write;
+    callbacks.onSeek = seek;
+    callbacks.onTell = tell;
+    callbacks.onInfo = info;
+  }
+
+  static ma_vfs *default_vfs(ma_vfs *vfs) {
+    return &static_cast<PackVFS *>(vfs)->fallback;
+  }
 
-AudioEngine::AudioEngine() : m_engine_initialized(false) {
+  static ma_result open(ma_vfs *vfs, const char *path, ma_uint32 mode,
+                        ma_vfs_file *result) {
+    File *file = new File{ResourcePack::find(path), 0, nullptr};
+    if (file->entry == nullptr || (mode & MA_OPEN_MODE_WRITE) != 0) {
+      file->entry = nullptr;
+      ma_result status =
+          ma_vfs_open(default_vfs(vfs), path, mode, &file->file);
+      if (status != MA_SUCCESS) {
+        delete file;
+        return status;
+      }
+    }
+    *result = file;
+    return MA_SUCCESS;
+  }
+
+  static ma_result open_w(ma_vfs *vfs, const wchar_t *path, ma_uint32 mode,
+                          ma_vfs_file *result) {
+    File *file = new File{nullptr, 0, nullptr};
+    ma_result status = ma_vfs_open_w(default_vfs(vfs), path, mode, &file->file);
+    if (status != MA_SUCCESS) {
+      delete file;
+      return status;
+    }
+    *result = file;
+    return MA_SUCCESS;
+  }
+
+  static ma_result close(ma_vfs *vfs, ma_vfs_file handle) {
+    File *file = static_cast<File *>(handle);
+    ma_result status = MA_SUCCESS;
+    if (file->entry == nullptr) {
+      status = ma_vfs_close(default_vfs(vfs), file->file);
+    }
+    delete file;
+    return status;
+  }
+
+  static ma_result read(ma_vfs *vfs, ma_vfs_file handle, void *dst,
+                        size_t size, size_t *read) {
+    File *file = static_cast<File *>(handle);
+    if (file->entry == nullptr) {
+      return ma_vfs_read(default_vfs(vfs), file->file, dst, size, read);
+    }
+    const size_t available = file->entry->size - file->cursor;
+    const size_t count = size < available ? size : available;
+    std::memcpy(dst, file->entry->data + file->cursor, count);
+    file->cursor += count;
+    if (read != nullptr) {
+      *read = count;
+    }
+    return count == 0 && size != 0 ? MA_AT_END : MA_SUCCESS;
+  }
+
+  static ma_result write(ma_vfs *vfs, ma_vfs_file handle, const void *src,
+                         size_t size, size_t *written) {
+    File *file = static_cast<File *>(handle);
+    if (file->entry == nullptr) {
+      return ma_vfs_write(default_vfs(vfs), file->file, src, size, written);
+    }
+    return MA_ACCESS_DENIED;
+  }
+
+  static ma_result seek(ma_vfs *vfs, ma_vfs_file handle, ma_int64 offset,
+                        ma_seek_origin origin) {
+    File *file = static_cast<File *>(handle);
+    if (file->entry == nullptr) {
+      return ma_vfs_seek(default_vfs(vfs), file->file, offset, origin);
+    }
+    ma_int64 base = 0;
+    if (origin == ma_seek_origin_current) {
+      base = static_cast<ma_int64>(file->cursor);
+    } else if (origin == ma_seek_origin_end) {
+      base = static_cast<ma_int64>(file->entry->size);
+    }
+    const ma_int64 cursor = base + offset;
+    if (cursor < 0 || cursor > static_cast<ma_int64>(file->entry->size)) {
+      return MA_BAD_SEEK;
+    }
+    file->cursor = static_cast<size_t>(cursor);
+    return MA_SUCCESS;
+  }
+
+  static ma_result tell(ma_vfs *vfs, ma_vfs_file handle, ma_int64 *cursor) {
+    File *file = static_cast<File *>(handle);
+    if (file->entry == nullptr) {
+      return ma_vfs_tell(default_vfs(vfs), file->file, cursor);
+    }
+    *cursor = static_cast<ma_int64>(file->cursor);
+    return MA_SUCCESS;
+  }
+
+  static ma_result info(ma_vfs *vfs, ma_vfs_file handle, ma_file_info *info) {
+    File *file = static_cast<File *>(handle);
+    if (file->entry == nullptr) {
+      return ma_vfs_info(default_vfs(vfs), file->file, info);
+    }
+    info->sizeInBytes = file->entry->size;
+    return MA_SUCCESS;
+  }
+};
+
+/* The engine runs without a device of its own, so that every mix period
+ * starts by executing the commands queued by the game thread */
+struct AudioEngine::Device {
+  ma_device device;
+
+  static void callback(ma_device *device, void *output, const void *input,
+                       ma_uint32 frame_count) {
+    YU_UNUSED(input);
+    AudioEngine *engine = static_cast<AudioEngine *>(device->pUserData);
+    engine->mix_period(static_cast<float *>(output), frame_count);
+  }
+};
+
+/* Frames mixed at once by AudioEngine::advance */
+static const size_t MIX_BLOCK_FRAMES = 1024;
+/* How long Sound waits for the mixer to execute commands that refer to it */
+static const std::chrono::milliseconds FLUSH_TIMEOUT(500);
+
+AudioEngine::AudioEngine(AudioBackend backend)
+    : m_backend(backend), m_engine_initialized(false), m_vfs(new PackVFS) {
   m_engine = new ma_engine;
+  if (m_backend == AudioBackend::DISABLED) {
+    LOG_INFO("Audio is disabled");
+    return;
+  }
 
-  ma_result result = ma_engine_init(nullptr, m_engine);
+  ma_engine_config config = ma_engine_config_init();
+  config.pResourceManagerVFS = m_vfs.get();
+  config.noDevice = MA_TRUE;
+  if (m_backend == AudioBackend::DEVICE) {
+    ma_device_config device_config =
+        ma_device_config_init(ma_device_type_playback);
+    device_config.playback.format = ma_format_f32;
+    device_config.dataCallback = Device::callback;
+    device_config.pUserData = this;
+    m_device.reset(new Device);
+    if (ma_device_init(nullptr, &device_config, &m_device->device) !=
+        MA_SUCCESS) {
+      LOG_CRITICAL("Failed to initialize playback device");
+      m_device.reset();
+      return;
+    }
+    config.channels = m_device->device.playback.channels;
+    config.sampleRate = m_device->device.sampleRate;
+  } else {
+    /* The engine is only pulled by `mix`, which also advances its clock */
+    config.channels = OFFLINE_CHANNELS;
+    config.sampleRate = OFFLINE_SAMPLE_RATE;
+    m_mix_buffer.resize(MIX_BLOCK_FRAMES * OFFLINE_CHANNELS);
+  }
+  ma_result result = ma_engine_init(&config, m_engine);
 
   /* Should we care about errors? ma_engine_init can return only OUT_OF_MEMORY
    * errors */
   if (result != MA_SUCCESS) {
     LOG_CRITICAL("Failed to initialize sound engine");
+    if (m_device) {
+      ma_device_uninit(&m_device->device);
+      m_device.reset();
+    }
     return;
   }
   m_engine_initialized = true;
+
+  /* Sounds are loaded by path, so register the packed files under the same
+   * names and let miniaudio decode them straight from the mapping */
+  ma_resource_manager *resource_manager =
+      ma_engine_get_resource_manager(m_engine);
+  for (const ResourcePack::Entry &entry : ResourcePack::entries()) {
+    if (std::strncmp(entry.path, "res/audio/", 10) != 0) {
+      continue;
+    }
+    result = ma_resource_manager_register_encoded_data(
+        resource_manager, entry.path, entry.data, entry.size);
+    if (result != MA_SUCCESS) {
+      LOG_ERROR("Failed to register packed sound: {}", entry.path);
+    }
+  }
+
+  m_voices.reset(new Voice[MAX_VOICES]);
+
+  if (m_device && ma_device_start(&m_device->device) != MA_SUCCESS) {
+    LOG_CRITICAL("Failed to start playback device");
+  }
 }
 
 AudioEngine::~AudioEngine() {
+  /* Stop the mixer before anything it reads goes away */
+  if (m_device) {
+    ma_device_uninit(&m_device->device);
+  }
+  if (const uint64_t dropped = dropped_commands()) {
+    LOG_WARN("Dropped {} audio commands on a full queue", dropped);
+  }
+  /* Voices are nodes of the engine's graph and go first */
+  for (size_t i = 0; i < m_voice_count; ++i) {
+    ma_sound_uninit(&m_voices[i].sound);
+    ma_audio_buffer_ref_uninit(&m_voices[i].buffer);
+  }
   if (m_engine_initialized) {
     ma_engine_uninit(m_engine);
   }
+  for (Effect &effect : m_effects) {
+    ma_free(effect.frames, nullptr);
+  }
   delete m_engine;
 }
 
-bool AudioEngine::play(const char *filename) const {
+SoundHandle AudioEngine::load_effect(const char *filename,
+                                     const EffectOptions &options) {
+  SoundHandle handle;
   if (!m_engine_initialized) {
+    return handle;
+  }
+  if (options.max_voices == 0 ||
+      m_voice_count + options.max_voices > MAX_VOICES) {
+    LOG_ERROR("Out of voices for sound effect: {}", filename);
+    return handle;
+  }
+
+  Memory::MappedFile file;
+  const Memory::FileView view = ResourcePack::open(filename, file);
+
+  /* Match the engine so that voices neither convert nor resample */
+  const ma_uint32 channels = ma_engine_get_channels(m_engine);
+  const ma_uint32 sample_rate = ma_engine_get_sample_rate(m_engine);
+  ma_decoder_config config =
+      ma_decoder_config_init(ma_format_f32, channels, sample_rate);
+  Effect effect;
+  ma_uint64 frame_count = 0;
+  if (view.empty() ||
+      ma_decode_memory(view.data, view.size, &config, &frame_count,
+                       &effect.frames) != MA_SUCCESS) {
+    LOG_ERROR("Failed to load sound effect: {}", filename);
+    return handle;
+  }
+  effect.frame_count = frame_count;
+  effect.first_voice = m_voice_count;
+  effect.voice_count = 0;
+  effect.min_interval =
+      static_cast<uint64_t>(options.min_interval * sample_rate);
+  effect.last_trigger = 0;
+  effect.last_tick = 0;
+  effect.priority = options.priority;
+
+  for (; effect.voice_count < options.max_voices; ++effect.voice_count) {
+    Voice &voice = m_voices[m_voice_count];
+    if (ma_audio_buffer_ref_init(ma_format_f32, channels, effect.frames,
+                                 frame_count, &voice.buffer) != MA_SUCCESS) {
+      break;
+    }
+    if (ma_sound_init_from_data_source(
+            m_engine, &voice.buffer,
+            MA_SOUND_FLAG_NO_PITCH | MA_SOUND_FLAG_NO_SPATIALIZATION, nullptr,
+            &voice.sound) != MA_SUCCESS) {
+      ma_audio_buffer_ref_uninit(&voice.buffer);
+      break;
+    }
+    voice.priority = effect.priority;
+    voice.start_time = 0;
+    ++m_voice_count;
+  }
+  if (effect.voice_count == 0) {
+    LOG_ERROR("Failed to initialize voices for sound effect: {}", filename);
+    ma_free(effect.frames, nullptr);
+    return handle;
+  }
+
+  handle.index = static_cast<uint16_t>(m_effects.size());
+  m_effects.push_back(effect);
+  return handle;
+}
+
+bool AudioEngine::play(SoundHandle handle) {
+  if (!handle.is_valid() || handle.index >= m_effects.size()) {
     return false;
   }
+  Effect &effect = m_effects[handle.index];
 
-  ma_result result = ma_engine_play_sound(m_engine, filename, nullptr);
-  if (result != MA_SUCCESS) {
-    LOG_ERROR("Failed to play sound at path: {}", filename);
+  /* A burst of collisions in one tick is heard as a single hit */
+  if (effect.last_tick == m_tick) {
+    return true;
+  }
+  const uint64_t now = ma_engine_get_time_in_pcm_frames(m_engine);
+  if (effect.last_tick != 0 &&
+      now - effect.last_trigger < effect.min_interval) {
     return false;
   }
 
+  Command command;
+  command.type = CommandType::PLAY_EFFECT;
+  command.priority = effect.priority;
+  command.first_voice = static_cast<uint8_t>(effect.first_voice);
+  command.voice_count = static_cast<uint8_t>(effect.voice_count);
+  if (!push(command)) {
+    return false;
+  }
+  effect.last_trigger = now;
+  effect.last_tick = m_tick;
   return true;
 }
 
+void AudioEngine::advance(float seconds) {
+  if (m_backend != AudioBackend::OFFLINE || !m_engine_initialized) {
+    return;
+  }
+
+  const double frames = seconds * OFFLINE_SAMPLE_RATE + m_mix_remainder;
+  uint64_t frame_count = static_cast<uint64_t>(frames);
+  m_mix_remainder = frames - static_cast<double>(frame_count);
+  while (frame_count > 0) {
+    const uint64_t block =
+        frame_count < MIX_BLOCK_FRAMES ? frame_count : MIX_BLOCK_FRAMES;
+    mix(m_mix_buffer.data(), block);
+    frame_count -= block;
+  }
+}
+
+uint64_t AudioEngine::mix(float *output, uint64_t frame_count) {
+  if (m_backend != AudioBackend::OFFLINE || !m_engine_initialized) {
+    return 0;
+  }
+  return mix_period(output, frame_count);
+}
+
+size_t AudioEngine::playing_voices() const {
+  size_t count = 0;
+  for (size_t i = 0; i < m_voice_count; ++i) {
+    if (ma_sound_is_playing(&m_voices[i].sound)) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+bool AudioEngine::push(const Command &command) {
+  if (!m_engine_initialized) {
+    return false;
+  }
+  if (!m_commands.push(command)) {
+    m_dropped_commands.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  ++m_pushed_commands;
+  return true;
+}
+
+void AudioEngine::flush() {
+  if (m_backend == AudioBackend::OFFLINE) {
+    /* The game thread is the mixer */
+    execute_commands();
+    return;
+  }
+  if (!m_device) {
+    return;
+  }
+
+  const std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::now() + FLUSH_TIMEOUT;
+  while (m_executed_commands.load(std::memory_order_acquire) <
+         m_pushed_commands) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      LOG_WARN("Timed out waiting for the audio command queue");
+      return;
+    }
+    std::this_thread::yield();
+  }
+}
+
+uint64_t AudioEngine::mix_period(float *output, uint64_t frame_count) {
+  execute_commands();
+
+  ma_uint64 frames_read = 0;
+  ma_engine_read_pcm_frames(m_engine, output, frame_count, &frames_read);
+  return frames_read;
+}
+
+void AudioEngine::execute_commands() {
+  uint64_t executed = 0;
+  Command command;
+  while (m_commands.pop(command)) {
+    ++executed;
+    switch (command.type) {
+    case CommandType::PLAY_EFFECT:
+      start_effect(command);
+      break;
+    case CommandType::PLAY_SOUND:
+      ma_sound_start(command.sound);
+      break;
+    case CommandType::STOP_SOUND:
+      ma_sound_stop(command.sound);
+      break;
+    case CommandType::SET_VOLUME:
+      ma_sound_set_volume(command.sound, command.volume);
+      break;
+    }
+  }
+  /* Published only after the commands have run, see flush() */
+  if (executed > 0) {
+    m_executed_commands.fetch_add(executed, std::memory_order_release);
+  }
+}
+
+void AudioEngine::start_effect(const Command &command) {
+  const uint64_t now = ma_engine_get_time_in_pcm_frames(m_engine);
+
+  /* An idle voice of the effect, or its oldest one past the cap */
+  Voice *voice = nullptr;
+  Voice *oldest = nullptr;
+  for (size_t i = 0; i < command.voice_count; ++i) {
+    Voice &candidate = m_voices[command.first_voice + i];
+    if (!ma_sound_is_playing(&candidate.sound)) {
+      voice = &candidate;
+      break;
+    }
+    if (oldest == nullptr || candidate.start_time < oldest->start_time) {
+      oldest = &candidate;
+    }
+  }
+
+  if (voice == nullptr) {
+    voice = oldest;
+  } else if (playing_voices() >= MAX_PLAYING) {
+    Voice *victim = steal_voice(command.priority);
+    if (victim == nullptr) {
+      return;
+    }
+    /* Stopped partway through, so the next start needs to rewind it */
+    ma_sound_stop(&victim->sound);
+    ma_sound_seek_to_pcm_frame(&victim->sound, 0);
+  }
+
+  /* ma_sound_start only rewinds sounds that played to the end */
+  ma_sound_seek_to_pcm_frame(&voice->sound, 0);
+  if (ma_sound_start(&voice->sound) == MA_SUCCESS) {
+    voice->start_time = now;
+  }
+}
+
+AudioEngine::Voice *AudioEngine::steal_voice(uint8_t priority) {
+  /* The oldest of the lowest priority voices, never a more important one */
+  Voice *victim = nullptr;
+  for (size_t i = 0; i < m_voice_count; ++i) {
+    Voice &voice = m_voices[i];
+    if (!ma_sound_is_playing(&voice.sound) || voice.priority > priority) {
+      continue;
+    }
+    if (victim == nullptr || voice.priority < victim->priority ||
+        (voice.priority == victim->priority &&
+         voice.start_time < victim->start_time)) {
+      victim = &voice;
+    }
+  }
+  return victim;
+}
+
 Sound::Sound(AudioEngine &engine) : m_loaded(false), m_audio_engine(engine) {
   m_sound = new ma_sound;
 }
 
 Sound::~Sound() {
   if (m_loaded) {
+    m_audio_engine.flush();
     ma_sound_uninit(m_sound);
   }
   delete m_sound;
 }
 
-bool Sound::load(const char *filename, bool loop, float volume) {
+bool Sound::load(const char *filename, bool loop, float volume,
+                 bool stream) {
   if (m_loaded) {
+    m_audio_engine.flush();
     ma_sound_uninit(m_sound);
+    m_loaded = false;
+  }
+  if (!m_audio_engine.is_initialized()) {
+    return false;
   }
 
-  ma_result result = ma_sound_init_from_file(m_audio_engine.m_engine, filename,
-                                             0, nullptr, nullptr, m_sound);
+  /* Streams open on the job thread too, playing silence until they do */
+  const ma_uint32 flags =
+      stream ? MA_SOUND_FLAG_STREAM | MA_SOUND_FLAG_ASYNC : 0;
+  ma_result result = ma_sound_init_from_file(
+      m_audio_engine.m_engine, filename, flags, nullptr, nullptr, m_sound);
   if (result != MA_SUCCESS) {
     LOG_ERROR("Failed to load sound: {}", filename);
     m_loaded = false;
@@ -74,11 +554,31 @@ bool Sound::play() const {
     return false;
   }
 
-  ma_result result = ma_sound_start(m_sound);
-  if (result != MA_SUCCESS) {
-    LOG_WARN("Failed to play sound");
+  AudioEngine::Command command;
+  command.type = AudioEngine::CommandType::PLAY_SOUND;
+  command.sound = m_sound;
+  return m_audio_engine.push(command);
+}
+
+bool Sound::stop() const {
+  if (!m_loaded) {
     return false;
   }
 
-  return true;
+  AudioEngine::Command command;
+  command.type = AudioEngine::CommandType::STOP_SOUND;
+  command.sound = m_sound;
+  return m_audio_engine.push(command);
+}
+
+bool Sound::set_volume(float volume) const {
+  if (!m_loaded) {
+    return false;
+  }
+
+  AudioEngine::Command command;
+  command.type = AudioEngine::CommandType::SET_VOLUME;
+  command.sound = m_sound;
+  command.volume = volume;
+  return m_audio_engine.push(command);
 }
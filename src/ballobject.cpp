@@ -1,11 +1,9 @@
 #include "breakout/ballobject.hpp"
 
-#include "breakout/texture2d.hpp"
-
 BallObject::BallObject() : GameObject(), radius(12.5f), is_stuck(true) {}
 
 BallObject::BallObject(glm::vec2 pos, float _radius, glm::vec2 _velocity,
-                       std::shared_ptr<Texture2D> sprite)
+                       TextureHandle sprite)
     : GameObject(pos, glm::vec2(_radius * 2.0f, _radius * 2.0f), sprite,
                  glm::vec3(1.0f), _velocity),
       radius(_radius), is_stuck(true), sticky(false), pass_through(false) {}
@@ -0,0 +1,314 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "breakout/block_compression.hpp"
+#include "breakout/log.hpp"
+
+/* From EXT_texture_compression_s3tc, which glad doesn't load */
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+
+namespace BlockCompression {
+
+static const uint32_t DDS_MAGIC = 0x20534444; /* "DDS " */
+static const uint32_t DDS_HEADER_SIZE = 124;
+static const uint32_t DDS_PIXELFORMAT_SIZE = 32;
+
+static const uint32_t DDSD_CAPS = 0x1;
+static const uint32_t DDSD_HEIGHT = 0x2;
+static const uint32_t DDSD_WIDTH = 0x4;
+static const uint32_t DDSD_PIXELFORMAT = 0x1000;
+static const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+static const uint32_t DDSD_LINEARSIZE = 0x80000;
+static const uint32_t DDPF_FOURCC = 0x4;
+static const uint32_t DDSCAPS_COMPLEX = 0x8;
+static const uint32_t DDSCAPS_TEXTURE = 0x1000;
+static const uint32_t DDSCAPS_MIPMAP = 0x400000;
+
+static const uint32_t FOURCC_DXT1 = 0x31545844; /* "DXT1" */
+static const uint32_t FOURCC_DXT5 = 0x35545844; /* "DXT5" */
+
+/* Field offsets inside the DDS header, counted after the magic */
+enum DdsField {
+  DDS_SIZE = 0,
+  DDS_FLAGS = 1,
+  DDS_HEIGHT = 2,
+  DDS_WIDTH = 3,
+  DDS_LINEAR_SIZE = 4,
+  DDS_MIPMAP_COUNT = 6,
+  DDS_PF_SIZE = 18,
+  DDS_PF_FLAGS = 19,
+  DDS_PF_FOURCC = 20,
+  DDS_CAPS = 26,
+};
+
+size_t block_size(Format format) { return format == Format::BC1 ? 8 : 16; }
+
+size_t level_size(Format format, uint32_t width, uint32_t height) {
+  const size_t blocks_x = std::max<uint32_t>(1, (width + 3) / 4);
+  const size_t blocks_y = std::max<uint32_t>(1, (height + 3) / 4);
+  return blocks_x * blocks_y * block_size(format);
+}
+
+uint32_t gl_format(Format format) {
+  return format == Format::BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+                               : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+}
+
+static uint16_t pack_565(const int *rgb) {
+  return static_cast<uint16_t>(((rgb[0] * 31 + 127) / 255) << 11 |
+                               ((rgb[1] * 63 + 127) / 255) << 5 |
+                               ((rgb[2] * 31 + 127) / 255));
+}
+
+static void unpack_565(uint16_t color, int *rgb) {
+  rgb[0] = ((color >> 11) & 31) * 255 / 31;
+  rgb[1] = ((color >> 5) & 63) * 255 / 63;
+  rgb[2] = (color & 31) * 255 / 31;
+}
+
+/* `block` holds 16 RGBA texels in row-major order */
+static void encode_color_block(const unsigned char *block, unsigned char *out) {
+  int lo[3] = {255, 255, 255}, hi[3] = {0, 0, 0};
+  for (int i = 0; i < 16; ++i) {
+    for (int c = 0; c < 3; ++c) {
+      lo[c] = std::min<int>(lo[c], block[i * 4 + c]);
+      hi[c] = std::max<int>(hi[c], block[i * 4 + c]);
+    }
+  }
+
+  /* Inset the bounding box slightly to reduce the error at its ends */
+  for (int c = 0; c < 3; ++c) {
+    const int inset = (hi[c] - lo[c]) / 16;
+    lo[c] += inset;
+    hi[c] -= inset;
+  }
+
+  uint16_t color0 = pack_565(hi);
+  uint16_t color1 = pack_565(lo);
+  if (color0 < color1) {
+    std::swap(color0, color1);
+  }
+
+  int palette[4][3];
+  unpack_565(color0, palette[0]);
+  unpack_565(color1, palette[1]);
+  for (int c = 0; c < 3; ++c) {
+    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+  }
+
+  uint32_t indices = 0;
+  if (color0 != color1) {
+    for (int i = 0; i < 16; ++i) {
+      int best = 0, best_error = 0x7fffffff;
+      for (int p = 0; p < 4; ++p) {
+        int error = 0;
+        for (int c = 0; c < 3; ++c) {
+          const int d = block[i * 4 + c] - palette[p][c];
+          error += d * d;
+        }
+        if (error < best_error) {
+          best_error = error;
+          best = p;
+        }
+      }
+      indices |= static_cast<uint32_t>(best) << (2 * i);
+    }
+  }
+
+  out[0] = color0 & 0xff;
+  out[1] = color0 >> 8;
+  out[2] = color1 & 0xff;
+  out[3] = color1 >> 8;
+  for (int i = 0; i < 4; ++i) {
+    out[4 + i] = (indices >> (8 * i)) & 0xff;
+  }
+}
+
+static void encode_alpha_block(const unsigned char *block, unsigned char *out) {
+  int alpha0 = 0, alpha1 = 255;
+  for (int i = 0; i < 16; ++i) {
+    alpha0 = std::max<int>(alpha0, block[i * 4 + 3]);
+    alpha1 = std::min<int>(alpha1, block[i * 4 + 3]);
+  }
+
+  /* alpha0 > alpha1 selects the 8 value mode */
+  int palette[8] = {alpha0, alpha1};
+  for (int p = 1; p < 7; ++p) {
+    palette[p + 1] = ((7 - p) * alpha0 + p * alpha1) / 7;
+  }
+
+  uint64_t indices = 0;
+  if (alpha0 != alpha1) {
+    for (int i = 0; i < 16; ++i) {
+      int best = 0, best_error = 0x7fffffff;
+      for (int p = 0; p < 8; ++p) {
+        const int error = std::abs(block[i * 4 + 3] - palette[p]);
+        if (error < best_error) {
+          best_error = error;
+          best = p;
+        }
+      }
+      indices |= static_cast<uint64_t>(best) << (3 * i);
+    }
+  }
+
+  out[0] = static_cast<unsigned char>(alpha0);
+  out[1] = static_cast<unsigned char>(alpha1);
+  for (int i = 0; i < 6; ++i) {
+    out[2 + i] = (indices >> (8 * i)) & 0xff;
+  }
+}
+
+static void encode_level(Format format, const unsigned char *pixels,
+                         uint32_t width, uint32_t height, unsigned char *out) {
+  unsigned char block[16 * 4];
+  for (uint32_t by = 0; by < height; by += 4) {
+    for (uint32_t bx = 0; bx < width; bx += 4) {
+      /* Edge blocks repeat the last row/column */
+      for (uint32_t y = 0; y < 4; ++y) {
+        for (uint32_t x = 0; x < 4; ++x) {
+          const uint32_t sx = std::min(bx + x, width - 1);
+          const uint32_t sy = std::min(by + y, height - 1);
+          std::memcpy(&block[(y * 4 + x) * 4],
+                      &pixels[(static_cast<size_t>(sy) * width + sx) * 4], 4);
+        }
+      }
+
+      if (format == Format::BC3) {
+        encode_alpha_block(block, out);
+        out += 8;
+      }
+      encode_color_block(block, out);
+      out += 8;
+    }
+  }
+}
+
+/* 2x2 box filter */
+static std::vector<unsigned char> downsample(const unsigned char *pixels,
+                                             uint32_t width, uint32_t height) {
+  const uint32_t next_width = std::max<uint32_t>(1, width / 2);
+  const uint32_t next_height = std::max<uint32_t>(1, height / 2);
+  std::vector<unsigned char> result(static_cast<size_t>(next_width) *
+                                    next_height * 4);
+
+  for (uint32_t y = 0; y < next_height; ++y) {
+    for (uint32_t x = 0; x < next_width; ++x) {
+      const uint32_t x0 = std::min(x * 2, width - 1);
+      const uint32_t x1 = std::min(x * 2 + 1, width - 1);
+      const uint32_t y0 = std::min(y * 2, height - 1);
+      const uint32_t y1 = std::min(y * 2 + 1, height - 1);
+      for (int c = 0; c < 4; ++c) {
+        const int sum = pixels[(static_cast<size_t>(y0) * width + x0) * 4 + c] +
+                        pixels[(static_cast<size_t>(y0) * width + x1) * 4 + c] +
+                        pixels[(static_cast<size_t>(y1) * width + x0) * 4 + c] +
+                        pixels[(static_cast<size_t>(y1) * width + x1) * 4 + c];
+        result[(static_cast<size_t>(y) * next_width + x) * 4 + c] =
+            static_cast<unsigned char>((sum + 2) / 4);
+      }
+    }
+  }
+  return result;
+}
+
+std::vector<unsigned char> encode(Format format, const unsigned char *pixels,
+                                  uint32_t width, uint32_t height,
+                                  uint32_t *levels) {
+  std::vector<unsigned char> result;
+  std::vector<unsigned char> level(
+      pixels, pixels + static_cast<size_t>(width) * height * 4);
+
+  *levels = 0;
+  for (;;) {
+    const size_t offset = result.size();
+    result.resize(offset + level_size(format, width, height));
+    encode_level(format, level.data(), width, height, &result[offset]);
+    ++*levels;
+
+    if (width == 1 && height == 1) {
+      break;
+    }
+    level = downsample(level.data(), width, height);
+    width = std::max<uint32_t>(1, width / 2);
+    height = std::max<uint32_t>(1, height / 2);
+  }
+  return result;
+}
+
+bool write_dds(const char *path, const Image &image) {
+  uint32_t header[DDS_HEADER_SIZE / 4] = {0};
+  header[DDS_SIZE] = DDS_HEADER_SIZE;
+  header[DDS_FLAGS] = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT |
+                      DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+  header[DDS_HEIGHT] = image.height;
+  header[DDS_WIDTH] = image.width;
+  header[DDS_LINEAR_SIZE] = static_cast<uint32_t>(
+      level_size(image.format, image.width, image.height));
+  header[DDS_MIPMAP_COUNT] = image.levels;
+  header[DDS_PF_SIZE] = DDS_PIXELFORMAT_SIZE;
+  header[DDS_PF_FLAGS] = DDPF_FOURCC;
+  header[DDS_PF_FOURCC] =
+      image.format == Format::BC1 ? FOURCC_DXT1 : FOURCC_DXT5;
+  header[DDS_CAPS] = DDSCAPS_TEXTURE |
+                     (image.levels > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+
+  std::ofstream file(path, std::ios::binary);
+  if (!file) {
+    LOG_ERROR("Failed to open file for writing: {}", path);
+    return false;
+  }
+  file.write(reinterpret_cast<const char *>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+  file.write(reinterpret_cast<const char *>(header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(image.data), image.size);
+  return static_cast<bool>(file);
+}
+
+bool parse_dds(const unsigned char *data, size_t size, Image &image) {
+  uint32_t magic;
+  uint32_t header[DDS_HEADER_SIZE / 4];
+  if (size < sizeof(magic) + sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&magic, data, sizeof(magic));
+  std::memcpy(header, data + sizeof(magic), sizeof(header));
+  if (magic != DDS_MAGIC || header[DDS_SIZE] != DDS_HEADER_SIZE ||
+      !(header[DDS_PF_FLAGS] & DDPF_FOURCC)) {
+    return false;
+  }
+
+  switch (header[DDS_PF_FOURCC]) {
+  case FOURCC_DXT1:
+    image.format = Format::BC1;
+    break;
+  case FOURCC_DXT5:
+    image.format = Format::BC3;
+    break;
+  default:
+    return false;
+  }
+
+  image.width = header[DDS_WIDTH];
+  image.height = header[DDS_HEIGHT];
+  image.levels = (header[DDS_FLAGS] & DDSD_MIPMAPCOUNT)
+                     ? std::max<uint32_t>(1, header[DDS_MIPMAP_COUNT])
+                     : 1;
+  image.data = data + sizeof(magic) + sizeof(header);
+  image.size = size - sizeof(magic) - sizeof(header);
+
+  /* Make sure all the levels are present */
+  size_t expected = 0;
+  uint32_t width = image.width, height = image.height;
+  for (uint32_t level = 0; level < image.levels; ++level) {
+    expected += level_size(image.format, width, height);
+    width = std::max<uint32_t>(1, width / 2);
+    height = std::max<uint32_t>(1, height / 2);
+  }
+  return image.width > 0 && image.height > 0 && expected <= image.size;
+}
+
+} // namespace BlockCompression
@@ -1,6 +1,9 @@
 #include <GLFW/glfw3.h>
 
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <future>
 #include <glm/ext/matrix_clip_space.hpp>
 #include <glm/ext/matrix_float4x4.hpp>
 #include <glm/common.hpp>
@@ -11,7 +14,9 @@
 
 #include "breakout/breakout_game.hpp"
 #include "breakout/input.hpp"
+#include "breakout/log.hpp"
 #include "breakout/audio.hpp"
+#include "breakout/memory.hpp"
 #include "breakout/resource_manager.hpp"
 #include "breakout/shader.hpp"
 #include "breakout/sprite_renderer.hpp"
@@ -19,13 +24,49 @@
 #include "breakout/gamelevel.hpp"
 #include "breakout/ballobject.hpp"
 #include "breakout/powerup.hpp"
+#include "breakout/profiler.hpp"
 #include "breakout/postprocessor.hpp"
 #include "breakout/text_renderer.hpp"
 #include "breakout/player.hpp"
-
-BreakoutGame::BreakoutGame(uint32_t width, uint32_t height)
-    : m_lives(Player::INITIAL_NUM_LIVES), m_state(GameState::MENU),
-      m_width(width), m_height(height) {}
+#include "breakout/texture2d.hpp"
+
+struct PowerUpInfo {
+  PowerUpType type;
+  const char *texture_name;
+  glm::vec3 color;
+  float duration;
+  uint8_t spawn_chance;
+};
+
+/* TODO: Use json format to load all necessary data */
+static const PowerUpInfo POWERUP_INFO[] = {
+    {PowerUpType::SPEED, "powerup_speed", glm::vec3(0.5f, 0.5f, 1.0f), 0.0f,
+     75},
+    {PowerUpType::STICKY, "powerup_sticky", glm::vec3(1.0f, 0.5f, 1.0f), 20.0f,
+     75},
+    {PowerUpType::PASS_THROUGH, "powerup_passthrough",
+     glm::vec3(1.0f, 0.5f, 1.0f), 10.0f, 75},
+    {PowerUpType::PAD_SIZE_INCREASE, "powerup_increase",
+     glm::vec3(1.0f, 0.6f, 0.4), 0.0f, 75},
+    {PowerUpType::CONFUSE, "powerup_confuse", glm::vec3(1.0f, 0.3f, 0.3f),
+     15.0f, 15},
+    {PowerUpType::CHAOS, "powerup_chaos", glm::vec3(0.9f, 0.25f, 0.25f), 15.0f,
+     15},
+};
+static const size_t POWERUP_COUNT =
+    sizeof(POWERUP_INFO) / sizeof(POWERUP_INFO[0]);
+/* More than are ever falling or active at once in practice */
+static const size_t POWERUP_CAPACITY = 32;
+
+BreakoutGame::BreakoutGame(uint32_t width, uint32_t height,
+                           AudioBackend audio_backend,
+                           ResourceManager *resources)
+    : m_resources(resources ? resources : &ResourceManager::global()),
+      m_lives(Player::INITIAL_NUM_LIVES), m_audio_backend(audio_backend),
+      m_state(GameState::MENU), m_width(width), m_height(height) {
+  /* Breaking bricks shouldn't have to grow the list mid-game */
+  m_powerups.reserve(POWERUP_CAPACITY);
+}
 
 BreakoutGame::~BreakoutGame() {}
 
@@ -50,23 +91,143 @@ static bool is_powerup_active(std::vector<PowerUp> &powerups,
   return false;
 }
 
+static const char *const LEVEL_PATHS[] = {
+    "res/levels/one.level",   "res/levels/two.level",
+    "res/levels/three.level", "res/levels/four.level",
+    "res/levels/five.level",
+};
+static const size_t LEVEL_COUNT = sizeof(LEVEL_PATHS) / sizeof(LEVEL_PATHS[0]);
+
+/* The last level has more rows */
+static float level_height(size_t index, uint32_t window_height) {
+  return index != LEVEL_COUNT - 1 ? window_height / 2.0f
+                                  : window_height / 1.3f;
+}
+
+/* Only the first level is parsed up front, the others are preloaded in the
+ * background while it is played or browsed */
 void BreakoutGame::load_levels() {
-  const std::vector<std::string> levels = {
-      "one.level", "two.level", "three.level", "four.level", "five.level",
-  };
+  m_level_sprites.block = ResourceManager::texture_handle("block");
+  m_level_sprites.block_solid = ResourceManager::texture_handle("block_solid");
+
+  m_levels.clear();
+  m_levels.resize(LEVEL_COUNT);
+  m_level_loaded.assign(LEVEL_COUNT, false);
+  load_level(0);
+  m_current_level = 0;
+  preload_level(1 % LEVEL_COUNT);
+}
+
+void BreakoutGame::load_level(size_t index) {
+  /* Don't let an older parse overwrite this one */
+  if (m_preload.valid() && m_preload_index == index) {
+    m_preload.wait();
+    m_preload = std::future<GameLevel>();
+  }
+
+  m_levels[index].load(LEVEL_PATHS[index], m_height, m_width,
+                       level_height(index, m_height), m_level_sprites);
+  m_level_loaded[index] = true;
+}
+
+void BreakoutGame::select_level(size_t index) {
+  if (!m_level_loaded[index]) {
+    if (m_preload.valid() && m_preload_index == index) {
+      m_levels[index] = m_preload.get();
+      m_level_loaded[index] = true;
+    } else {
+      load_level(index);
+    }
+  }
+  m_current_level = index;
+  prefetch_level(index);
+}
 
-  for (const std::string &path : levels) {
+void BreakoutGame::preload_level(size_t index) {
+  if (m_level_loaded[index] || m_preload.valid()) {
+    return;
+  }
+
+  m_preload_index = index;
+  ++m_preloads_started;
+  const uint32_t width = m_width, height = m_height;
+  const GameLevel::Sprites sprites = m_level_sprites;
+  m_preload = std::async(std::launch::async, [=]() {
     GameLevel level;
-    level.load(("res/levels/" + path).c_str(), m_height, m_width,
-               path != "five.level" ? m_height / 2.0f : m_height / 1.3f);
-    m_levels.push_back(std::move(level));
+    level.load(LEVEL_PATHS[index], height, width, level_height(index, height),
+               sprites);
+    return level;
+  });
+}
+
+void BreakoutGame::poll_preload() {
+  if (m_preload.valid() &&
+      m_preload.wait_for(std::chrono::seconds(0)) ==
+          std::future_status::ready) {
+    const size_t index = m_preload_index;
+    m_levels[index] = m_preload.get();
+    m_level_loaded[index] = true;
+    /* Have the textures ready before the level is selected */
+    if (m_graphics) {
+      ResourceManager::prefetch_textures(m_levels[index].textures());
+    }
   }
-  m_current_level = 0;
+
+  /* The levels that W and S select next */
+  const size_t next = (m_current_level + 1) % LEVEL_COUNT;
+  const size_t previous = (m_current_level + LEVEL_COUNT - 1) % LEVEL_COUNT;
+  preload_level(next);
+  preload_level(previous);
+}
+
+void BreakoutGame::prefetch_level(size_t index) {
+  if (!m_graphics) {
+    return;
+  }
+  m_prefetch = m_common_textures;
+  const std::vector<TextureHandle> &textures = m_levels[index].textures();
+  m_prefetch.insert(m_prefetch.end(), textures.begin(), textures.end());
+  /* What was fetched for the level left behind may go again */
+  ResourceManager::unpin_textures();
+  ResourceManager::prefetch_textures(m_prefetch);
+}
+
+bool BreakoutGame::hot_reload() {
+  ResourceManager::Scope resources(*m_resources);
+  m_changed_files.clear();
+  bool reloaded = ResourceManager::poll_hot_reload(m_changed_files);
+
+  for (const std::string &path : m_changed_files) {
+    for (size_t i = 0; i < LEVEL_COUNT; ++i) {
+      if (path == LEVEL_PATHS[i]) {
+        LOG_INFO("Reloading level: {}", path);
+        load_level(i);
+        reloaded = true;
+      }
+    }
+  }
+  return reloaded;
 }
 
 void BreakoutGame::init() {
+  ResourceManager::Scope resources(*m_resources);
   ResourceManager::load_resources();
+  m_graphics = true;
+
+  init_graphics();
+  init_world();
+  prefetch_level(m_current_level);
+}
 
+void BreakoutGame::init_simulation() {
+  ResourceManager::Scope resources(*m_resources);
+  ResourceManager::register_resources();
+  m_graphics = false;
+
+  init_world();
+}
+
+void BreakoutGame::init_graphics() {
   std::shared_ptr<Shader> shader = ResourceManager::shader("sprite");
   const glm::mat4 projection =
       glm::ortho(0.0f, static_cast<float>(m_width), 0.0f,
@@ -81,32 +242,70 @@ void BreakoutGame::init() {
   shader->bind();
   shader->setmat4f("projection", projection);
 
-  const glm::vec2 player_pos = calc_player_pos(m_width);
-  const glm::vec2 ball_pos = calc_ball_pos(player_pos);
-
-  m_ball = std::make_unique<BallObject>(ball_pos, BallObject::INITIAL_RADIUS,
-                                        BallObject::INITIAL_VELOCITY,
-                                        ResourceManager::texture("face"));
-
-  m_player = std::make_unique<Player>(player_pos, Player::INITIAL_SIZE,
-                                      ResourceManager::texture("paddle"));
   m_particles = std::make_unique<ParticleGenerator>(
-      ResourceManager::shader("particle"), ResourceManager::texture("particle"),
-      500);
+      ResourceManager::shader("particle"),
+      ResourceManager::texture_handle("particle"), 500);
+  m_particles->seed(m_seed);
   m_postprocessor = std::make_unique<PostProcessor>(
       ResourceManager::shader("postprocessing"), m_width, m_height);
 
   m_text_renderer = std::make_unique<TextRenderer>(m_width, m_height);
   m_text_renderer->load("res/fonts/Anton.ttf", 24);
 
-  m_audio_engine = std::make_unique<AudioEngine>();
+#ifdef BREAKOUT_PROFILER
+  m_gpu_timer = std::make_unique<Profiler::GpuTimer>();
+#endif /* BREAKOUT_PROFILER */
+}
+
+void BreakoutGame::init_world() {
+  m_background = ResourceManager::texture_handle("background");
+  m_powerup_textures.clear();
+  for (const PowerUpInfo &pinfo : POWERUP_INFO) {
+    m_powerup_textures.push_back(
+        ResourceManager::texture_handle(pinfo.texture_name));
+  }
+  const TextureHandle face = ResourceManager::texture_handle("face");
+  const TextureHandle paddle = ResourceManager::texture_handle("paddle");
+  const TextureHandle particle = ResourceManager::texture_handle("particle");
+  m_common_textures = m_powerup_textures;
+  m_common_textures.insert(m_common_textures.end(),
+                           {m_background, face, paddle, particle});
+
+  const glm::vec2 player_pos = calc_player_pos(m_width);
+  const glm::vec2 ball_pos = calc_ball_pos(player_pos);
+
+  m_ball = std::make_unique<BallObject>(ball_pos, BallObject::INITIAL_RADIUS,
+                                        BallObject::INITIAL_VELOCITY, face);
+
+  m_player =
+      std::make_unique<Player>(player_pos, Player::INITIAL_SIZE, paddle);
+
+  m_audio_engine = std::make_unique<AudioEngine>(m_audio_backend);
 
   m_main_theme = std::make_unique<Sound>(*m_audio_engine);
-  m_main_theme->load("res/audio/breakout.mp3", true, 0.3f);
+  m_main_theme->load("res/audio/breakout.mp3", true, 0.3f, true);
   m_main_theme->play();
 
-  m_paddle_sound = std::make_unique<Sound>(*m_audio_engine);
-  m_paddle_sound->load("res/audio/bleep.mp3");
+  /* Bricks break in bursts, so their hits are capped and spaced out, while
+   * power-ups and the paddle win the voices over them */
+  EffectOptions hit_options;
+  hit_options.max_voices = 4;
+  hit_options.min_interval = 0.03f;
+  m_solid_sound =
+      m_audio_engine->load_effect("res/audio/solid.wav", hit_options);
+  m_block_sound =
+      m_audio_engine->load_effect("res/audio/bleep.wav", hit_options);
+
+  EffectOptions paddle_options;
+  paddle_options.min_interval = 0.05f;
+  paddle_options.priority = 1;
+  m_paddle_sound =
+      m_audio_engine->load_effect("res/audio/bleep.mp3", paddle_options);
+
+  EffectOptions powerup_options;
+  powerup_options.priority = 2;
+  m_powerup_sound =
+      m_audio_engine->load_effect("res/audio/powerup.wav", powerup_options);
 
   load_levels();
 }
@@ -127,23 +326,36 @@ void BreakoutGame::reset_player() {
   m_ball->reset(calc_ball_pos(m_player->position),
                 BallObject::INITIAL_VELOCITY);
 
-  m_postprocessor->disable_effect(PostProcessor::Effect::CHAOS);
-  m_postprocessor->disable_effect(PostProcessor::Effect::CONFUSE);
+  disable_effect(PostProcessor::Effect::CHAOS);
+  disable_effect(PostProcessor::Effect::CONFUSE);
+  disable_effect(PostProcessor::Effect::SHAKE);
+  m_shake_time = 0.0f;
 }
 
 void BreakoutGame::update(float dt) {
+  PROFILE_SCOPE("update");
+  Memory::AllocationScope allocations(m_allocations.update);
+  ResourceManager::Scope resources(*m_resources);
+  m_stats_overlay.add_tick();
+  m_audio_engine->begin_tick();
+
   m_ball->move(dt, m_width, m_height);
 
   resolve_collisions();
 
-  const glm::vec2 offset = glm::vec2(m_ball->radius / 2.0f, -m_ball->radius);
-  m_particles->update(dt, *m_ball, 2, offset);
+  /* Particles are purely visual */
+  if (m_particles) {
+    PROFILE_SCOPE("update particles");
+    const glm::vec2 offset =
+        glm::vec2(m_ball->radius / 2.0f, -m_ball->radius);
+    m_particles->update(dt, *m_ball, 2, offset);
+  }
 
   update_powerups(dt);
 
   m_shake_time -= dt;
   if (m_shake_time <= 0.0f) {
-    m_postprocessor->disable_effect(PostProcessor::Effect::SHAKE);
+    disable_effect(PostProcessor::Effect::SHAKE);
   }
 
   if (m_ball->position.y <= 0) {
@@ -161,23 +373,35 @@ void BreakoutGame::update(float dt) {
     reset_level();
     reset_player();
 
-    m_postprocessor->enable_effect(PostProcessor::Effect::CHAOS);
+    enable_effect(PostProcessor::Effect::CHAOS);
     m_state = GameState::WIN;
   }
 }
 
 void BreakoutGame::process_input(float dt) {
+  PROFILE_SCOPE("process_input");
+  Memory::AllocationScope allocations(m_allocations.input);
+  ResourceManager::Scope resources(*m_resources);
+  poll_preload();
+  /* Offline audio runs on the game's clock, whether simulating or not */
+  m_audio_engine->advance(dt);
+
+  if (m_input.is_key_processed(KeyCode::KEY_F3)) {
+    set_stats_visible(!m_stats_overlay.is_visible());
+    m_input.key_unset_proccessed(KeyCode::KEY_F3);
+  }
+
   switch (m_state) {
   case GameState::ACTIVE: {
     const float velocity = Player::INITIAL_VELOCITY * dt;
-    if (Input::is_key_pressed(KeyCode::KEY_A) && m_player->position.x >= 0) {
+    if (m_input.is_key_pressed(KeyCode::KEY_A) && m_player->position.x >= 0) {
       m_player->position.x -= velocity;
       if (m_ball->is_stuck) {
         m_ball->position.x -= velocity;
       }
     }
 
-    if (Input::is_key_pressed(KeyCode::KEY_D) &&
+    if (m_input.is_key_pressed(KeyCode::KEY_D) &&
         m_player->position.x <= m_width - m_player->size.x) {
       m_player->position.x += velocity;
       if (m_ball->is_stuck) {
@@ -185,34 +409,33 @@ void BreakoutGame::process_input(float dt) {
       }
     }
 
-    if (Input::is_key_pressed(KeyCode::KEY_SPACE)) {
+    if (m_input.is_key_pressed(KeyCode::KEY_SPACE)) {
       m_ball->is_stuck = false;
     }
     break;
   }
 
   case GameState::MENU: {
-    if (Input::is_key_processed(KeyCode::KEY_ENTER)) {
+    if (m_input.is_key_processed(KeyCode::KEY_ENTER)) {
       m_state = GameState::ACTIVE;
-      Input::key_unset_proccessed(KeyCode::KEY_ENTER);
+      m_input.key_unset_proccessed(KeyCode::KEY_ENTER);
     }
-    if (Input::is_key_processed(KeyCode::KEY_W)) {
-      m_current_level = (m_current_level + 1) % m_levels.size();
-      Input::key_unset_proccessed(KeyCode::KEY_W);
+    if (m_input.is_key_processed(KeyCode::KEY_W)) {
+      select_level((m_current_level + 1) % m_levels.size());
+      m_input.key_unset_proccessed(KeyCode::KEY_W);
     }
-    if (Input::is_key_processed(KeyCode::KEY_S)) {
-      m_current_level =
-          (m_current_level + m_levels.size() - 1) % m_levels.size();
-      Input::key_unset_proccessed(KeyCode::KEY_S);
+    if (m_input.is_key_processed(KeyCode::KEY_S)) {
+      select_level((m_current_level + m_levels.size() - 1) % m_levels.size());
+      m_input.key_unset_proccessed(KeyCode::KEY_S);
     }
     break;
   }
 
   case GameState::WIN: {
-    if (Input::is_key_processed(KeyCode::KEY_ENTER)) {
-      m_postprocessor->disable_effect(PostProcessor::Effect::CHAOS);
+    if (m_input.is_key_processed(KeyCode::KEY_ENTER)) {
+      disable_effect(PostProcessor::Effect::CHAOS);
       m_state = GameState::MENU;
-      Input::key_unset_proccessed(KeyCode::KEY_ENTER);
+      m_input.key_unset_proccessed(KeyCode::KEY_ENTER);
     }
     break;
   }
@@ -220,34 +443,71 @@ void BreakoutGame::process_input(float dt) {
 }
 
 void BreakoutGame::render() {
+  PROFILE_SCOPE("render");
+  Memory::AllocationScope allocations(m_allocations.render);
+  ResourceManager::Scope resources(*m_resources);
+#ifdef BREAKOUT_PROFILER
+  m_gpu_timer->begin_frame();
+#endif /* BREAKOUT_PROFILER */
+  const StatsOverlay::Counters stats = collect_stats();
+  m_stats_overlay.add_frame(glfwGetTime());
   if (m_state == GameState::ACTIVE || m_state == GameState::MENU ||
       m_state == GameState::WIN) {
+    for (size_t i = 0; i < PostProcessor::EFFECTS_COUNT; ++i) {
+      const auto effect = static_cast<PostProcessor::Effect>(i);
+      if (m_effects[i]) {
+        m_postprocessor->enable_effect(effect);
+      } else {
+        m_postprocessor->disable_effect(effect);
+      }
+    }
     m_postprocessor->begin_render();
 
-    m_renderer->draw(*ResourceManager::texture("background"),
-                     glm::vec2(0.0f, m_height), glm::vec2(m_width, m_height),
-                     0.0f);
-    m_levels[m_current_level].draw(*m_renderer);
+    {
+      PROFILE_SCOPE("render level");
+      PROFILE_GPU_SCOPE(*m_gpu_timer, "sprites");
+      if (Texture2D *background = ResourceManager::texture(m_background)) {
+        m_renderer->draw(*background, glm::vec2(0.0f, m_height),
+                         glm::vec2(m_width, m_height), 0.0f);
+      }
+      m_levels[m_current_level].draw(*m_renderer);
 
-    m_player->draw(*m_renderer);
+      m_player->draw(*m_renderer);
 
-    for (PowerUp &powerup : m_powerups) {
-      if (!powerup.is_destroyed) {
-        powerup.draw(*m_renderer);
+      for (PowerUp &powerup : m_powerups) {
+        if (!powerup.is_destroyed) {
+          powerup.draw(*m_renderer);
+        }
       }
     }
 
-    m_particles->draw();
+    {
+      PROFILE_SCOPE("render particles");
+      PROFILE_GPU_SCOPE(*m_gpu_timer, "particles");
+      m_particles->draw();
+    }
     m_ball->draw(*m_renderer);
 
-    m_postprocessor->end_render();
-    m_postprocessor->render(glfwGetTime());
+    {
+      PROFILE_SCOPE("post-process");
+      {
+        PROFILE_GPU_SCOPE(*m_gpu_timer, "msaa resolve");
+        m_postprocessor->end_render();
+      }
+      PROFILE_GPU_SCOPE(*m_gpu_timer, "effects");
+      m_postprocessor->render(glfwGetTime());
+    }
 
-    std::string lives = "Lives: " + std::to_string(m_lives);
-    m_text_renderer->render(lives.c_str(), 5.0f, m_height - 30.0f, 1.0f);
+    PROFILE_SCOPE("render text");
+    PROFILE_GPU_SCOPE(*m_gpu_timer, "text");
+    char lives[32];
+    std::snprintf(lives, sizeof(lives), "Lives: %d", m_lives);
+    m_text_renderer->render(lives, 5.0f, m_height - 30.0f, 1.0f);
   }
 
   if (m_state == GameState::MENU) {
+    PROFILE_SCOPE("render text");
+    PROFILE_GPU_SCOPE(*m_gpu_timer, "text");
     m_text_renderer->render("Press ENTER to start", 300.0f, m_height / 2.0f,
                             1.0f);
     m_text_renderer->render("Press W or S to select level", 295.0f,
@@ -255,12 +515,93 @@ void BreakoutGame::render() {
   }
 
   if (m_state == GameState::WIN) {
+    PROFILE_SCOPE("render text");
+    PROFILE_GPU_SCOPE(*m_gpu_timer, "text");
     m_text_renderer->render("You WON!!!", 300.0f, m_height / 2.0f, 1.0,
                             glm::vec3(0.0, 1.0, 0.0));
     m_text_renderer->render("Press ENTER to retry or ESC to quit", 130.0f,
                             m_height / 2.0f + 30.0f, 1.0,
                             glm::vec3(1.0, 1.0, 0.0));
   }
+
+  if (m_stats_overlay.is_visible()) {
+    PROFILE_SCOPE("render stats");
+    m_stats_overlay.draw(*m_text_renderer, stats, 5.0f, m_height - 55.0f);
+  }
+
+  ResourceManager::end_frame();
+}
+
+const BallObject &BreakoutGame::ball() const { return *m_ball; }
+
+const Player &BreakoutGame::player() const { return *m_player; }
+
+bool BreakoutGame::is_simulating() const {
+  return m_state == GameState::ACTIVE;
+}
+
+bool BreakoutGame::is_animated() const {
+  /* Keep the overlay's numbers current */
+  if (m_state == GameState::ACTIVE || m_stats_overlay.is_visible()) {
+    return true;
+  }
+
+  /* Menus are static apart from the post-processing effects */
+  for (bool enabled : m_effects) {
+    if (enabled) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void BreakoutGame::seed(uint32_t seed) {
+  m_seed = seed;
+  m_random.seed(seed);
+  if (m_particles) {
+    m_particles->seed(seed);
+  }
+}
+
+void BreakoutGame::set_stats_visible(bool visible) {
+  m_stats_overlay.set_visible(visible);
+}
+
+StatsOverlay::Counters BreakoutGame::collect_stats() {
+  StatsOverlay::Counters counters;
+  counters.render += m_renderer->stats();
+  counters.render += m_particles->stats();
+  counters.render += m_postprocessor->stats();
+  counters.render += m_text_renderer->stats();
+  m_renderer->reset_stats();
+  m_particles->reset_stats();
+  m_postprocessor->reset_stats();
+  m_text_renderer->reset_stats();
+
+  counters.particles = m_particles->live_particles();
+  for (const PowerUp &powerup : m_powerups) {
+    if (!powerup.is_destroyed) {
+      ++counters.powerups;
+    }
+  }
+  counters.bricks = m_levels[m_current_level].bricks_remaining();
+  counters.texture_memory = ResourceManager::texture_memory_usage();
+  counters.input_allocations = m_allocations.input;
+  counters.update_allocations = m_allocations.update;
+  counters.render_allocations = m_allocations.render;
+  return counters;
+}
+
+void BreakoutGame::enable_effect(PostProcessor::Effect effect) {
+  m_effects[static_cast<size_t>(effect)] = true;
+}
+
+void BreakoutGame::disable_effect(PostProcessor::Effect effect) {
+  m_effects[static_cast<size_t>(effect)] = false;
+}
+
+bool BreakoutGame::is_effect_enabled(PostProcessor::Effect effect) const {
+  return m_effects[static_cast<size_t>(effect)];
 }
 
 glm::vec2 vector_direction(glm::vec2 target) {
@@ -326,15 +667,15 @@ void BreakoutGame::activate_powerup(PowerUp &powerup) {
   }
 
   case PowerUpType::CONFUSE: {
-    if (!m_postprocessor->is_effect_enabled(PostProcessor::Effect::CHAOS)) {
-      m_postprocessor->enable_effect(PostProcessor::Effect::CONFUSE);
+    if (!is_effect_enabled(PostProcessor::Effect::CHAOS)) {
+      enable_effect(PostProcessor::Effect::CONFUSE);
     }
     break;
   }
 
   case PowerUpType::CHAOS: {
-    if (!m_postprocessor->is_effect_enabled(PostProcessor::Effect::CONFUSE)) {
-      m_postprocessor->enable_effect(PostProcessor::Effect::CHAOS);
+    if (!is_effect_enabled(PostProcessor::Effect::CONFUSE)) {
+      enable_effect(PostProcessor::Effect::CHAOS);
     }
     break;
   }
@@ -350,35 +691,47 @@ bool check_collision(const GameObject &one, const GameObject &two) {
   return collisionX && collisionY;
 }
 
-void BreakoutGame::resolve_box_collisions() {
-  for (GameObject &box : m_levels[m_current_level].bricks()) {
+GameObject *find_box_collision(BallObject &ball,
+                               std::vector<GameObject> &bricks,
+                               Collision &collision) {
+  for (GameObject &box : bricks) {
     if (box.is_destroyed) {
       continue;
     }
 
-    Collision collision = check_collision(*m_ball, box);
-    if (!collision.collided) {
-      continue;
+    collision = check_collision(ball, box);
+    if (collision.collided) {
+      return &box;
     }
+  }
+  return nullptr;
+}
 
-    if (box.is_solid) {
-      m_audio_engine->play("res/audio/solid.wav");
-      m_shake_time = 0.05f;
-      m_postprocessor->enable_effect(PostProcessor::Effect::SHAKE);
-    } else {
-      m_audio_engine->play("res/audio/bleep.wav");
-      box.is_destroyed = true;
-      spawn_powerups(box.position);
-    }
+void BreakoutGame::resolve_box_collisions() {
+  Collision collision(false, glm::vec2(0.0f), glm::vec2(0.0f));
+  GameObject *hit = find_box_collision(
+      *m_ball, m_levels[m_current_level].bricks(), collision);
+  if (!hit) {
+    return;
+  }
 
-    glm::vec2 dir = collision.direction;
-    glm::vec2 diff = collision.difference;
-    if (!m_ball->pass_through || box.is_solid) {
-      glm::vec2 penetration = diff - dir * m_ball->radius;
-      m_ball->velocity = glm::reflect(m_ball->velocity, -1.0f * dir);
-      m_ball->position += penetration;
-    }
-    break;
+  GameObject &box = *hit;
+  if (box.is_solid) {
+    m_audio_engine->play(m_solid_sound);
+    m_shake_time = 0.05f;
+    enable_effect(PostProcessor::Effect::SHAKE);
+  } else {
+    m_audio_engine->play(m_block_sound);
+    box.is_destroyed = true;
+    spawn_powerups(box.position);
+  }
+
+  glm::vec2 dir = collision.direction;
+  glm::vec2 diff = collision.difference;
+  if (!m_ball->pass_through || box.is_solid) {
+    glm::vec2 penetration = diff - dir * m_ball->radius;
+    m_ball->velocity = glm::reflect(m_ball->velocity, -1.0f * dir);
+    m_ball->position += penetration;
   }
 }
 
@@ -387,11 +740,12 @@ void BreakoutGame::resolve_powerup_collisions() {
     if (power_up.is_destroyed) {
       continue;
     }
-    if (power_up.position.x <= 0) {
+    /* Missed power-ups fall off the bottom of the screen */
+    if (power_up.position.y <= 0) {
       power_up.is_destroyed = true;
     }
     if (check_collision(*m_player, power_up)) {
-      m_audio_engine->play("res/audio/powerup.wav");
+      m_audio_engine->play(m_powerup_sound);
 
       activate_powerup(power_up);
       power_up.is_destroyed = true;
@@ -403,7 +757,7 @@ void BreakoutGame::resolve_powerup_collisions() {
 void BreakoutGame::resolve_player_collisions() {
   Collision result = check_collision(*m_ball, *m_player);
   if (!m_ball->is_stuck && result.collided) {
-    m_paddle_sound->play();
+    m_audio_engine->play(m_paddle_sound);
 
     float center_board = m_player->position.x + m_player->size.x / 2.0f;
     float distance = m_ball->position.x + m_ball->radius - center_board;
@@ -421,51 +775,28 @@ void BreakoutGame::resolve_player_collisions() {
 }
 
 void BreakoutGame::resolve_collisions() {
+  PROFILE_SCOPE("collisions");
   resolve_box_collisions();
   resolve_powerup_collisions();
   resolve_player_collisions();
 }
 
-static bool roll(uint32_t chance) {
-  uint32_t random = rand() % chance;
-  return random == 0;
+static bool roll(std::minstd_rand &random, uint32_t chance) {
+  return random() % chance == 0;
 }
 
 void BreakoutGame::spawn_powerups(glm::vec2 position) {
-  struct PowerUpInfo {
-    PowerUpType type;
-    std::string texture_name;
-    glm::vec3 color;
-    float duration;
-    uint8_t spawn_chance;
-  };
-
-  /* TODO: Use json format to load all necessary data */
-  std::vector<PowerUpInfo> powerup_info = {
-      {PowerUpType::SPEED, "powerup_speed", glm::vec3(0.5f, 0.5f, 1.0f), 0.0f,
-       75},
-      {PowerUpType::STICKY, "powerup_sticky", glm::vec3(1.0f, 0.5f, 1.0f),
-       20.0f, 75},
-      {PowerUpType::PASS_THROUGH, "powerup_passthrough",
-       glm::vec3(1.0f, 0.5f, 1.0f), 10.0f, 75},
-      {PowerUpType::PAD_SIZE_INCREASE, "powerup_increase",
-       glm::vec3(1.0f, 0.6f, 0.4), 0.0f, 75},
-      {PowerUpType::CONFUSE, "powerup_confuse", glm::vec3(1.0f, 0.3f, 0.3f),
-       15.0f, 15},
-      {PowerUpType::CHAOS, "powerup_chaos", glm::vec3(0.9f, 0.25f, 0.25f),
-       15.0f, 15},
-  };
-
-  for (PowerUpInfo &pinfo : powerup_info) {
-    if (roll(pinfo.spawn_chance)) {
-      m_powerups.emplace_back(
-          pinfo.type, pinfo.color, pinfo.duration, position,
-          ResourceManager::texture(pinfo.texture_name.c_str()));
+  for (size_t i = 0; i < POWERUP_COUNT; ++i) {
+    const PowerUpInfo &pinfo = POWERUP_INFO[i];
+    if (roll(m_random, pinfo.spawn_chance)) {
+      m_powerups.emplace_back(pinfo.type, pinfo.color, pinfo.duration,
+                              position, m_powerup_textures[i]);
     }
   }
 }
 
 void BreakoutGame::update_powerups(float dt) {
+  PROFILE_SCOPE("update powerups");
   for (PowerUp &powerup : m_powerups) {
     powerup.position += powerup.velocity * dt;
     if (!powerup.is_activated()) {
@@ -496,12 +827,12 @@ void BreakoutGame::update_powerups(float dt) {
     }
 
     case PowerUpType::CONFUSE: {
-      m_postprocessor->disable_effect(PostProcessor::Effect::CONFUSE);
+      disable_effect(PostProcessor::Effect::CONFUSE);
       break;
     }
 
     case PowerUpType::CHAOS: {
-      m_postprocessor->disable_effect(PostProcessor::Effect::CHAOS);
+      disable_effect(PostProcessor::Effect::CHAOS);
       break;
     }
     default:
@@ -0,0 +1,84 @@
+#include "breakout/file_watcher.hpp"
+
+#if defined(BREAKOUT_HOT_RELOAD) && defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <algorithm>
+#endif /* BREAKOUT_HOT_RELOAD && __linux__ */
+
+#include "breakout/log.hpp"
+#include "breakout/macro.hpp"
+
+#if defined(BREAKOUT_HOT_RELOAD) && defined(__linux__)
+
+FileWatcher::~FileWatcher() {
+  if (m_fd != -1) {
+    close(m_fd);
+  }
+}
+
+bool FileWatcher::watch(const char *directory) {
+  if (m_fd == -1) {
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd == -1) {
+      LOG_WARN("Failed to initialize inotify");
+      return false;
+    }
+  }
+
+  /* Editors either write in place or write a copy and rename it over */
+  const int wd =
+      inotify_add_watch(m_fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO);
+  if (wd == -1) {
+    LOG_WARN("Failed to watch directory: {}", directory);
+    return false;
+  }
+  m_directories[wd] = directory;
+  return true;
+}
+
+void FileWatcher::poll(std::vector<std::string> &changed) {
+  if (m_fd == -1) {
+    return;
+  }
+
+  alignas(inotify_event) char buffer[4096];
+  for (;;) {
+    const ssize_t length = read(m_fd, buffer, sizeof(buffer));
+    if (length <= 0) {
+      /* EAGAIN, all pending events have been read */
+      return;
+    }
+
+    for (ssize_t offset = 0; offset < length;) {
+      const inotify_event *event =
+          reinterpret_cast<const inotify_event *>(buffer + offset);
+      offset += sizeof(inotify_event) + event->len;
+
+      auto it = m_directories.find(event->wd);
+      if (it == m_directories.end() || event->len == 0) {
+        continue;
+      }
+      const std::string path = it->second + "/" + event->name;
+      if (std::find(changed.begin(), changed.end(), path) == changed.end()) {
+        changed.push_back(path);
+      }
+    }
+  }
+}
+
+#else
+
+FileWatcher::~FileWatcher() {}
+
+bool FileWatcher::watch(const char *directory) {
+  YU_UNUSED(directory);
+  return false;
+}
+
+void FileWatcher::poll(std::vector<std::string> &changed) {
+  YU_UNUSED(changed);
+}
+
+#endif /* BREAKOUT_HOT_RELOAD && __linux__ */
@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "breakout/frame_stats.hpp"
+
+void FrameStats::reserve(size_t count) {
+  m_samples.reserve(count);
+  m_sorted.reserve(count);
+}
+
+void FrameStats::add(double milliseconds) { m_samples.push_back(milliseconds); }
+
+void FrameStats::clear() { m_samples.clear(); }
+
+size_t FrameStats::count() const { return m_samples.size(); }
+
+double FrameStats::average() const {
+  if (m_samples.empty()) {
+    return 0.0;
+  }
+
+  double sum = 0.0;
+  for (double sample : m_samples) {
+    sum += sample;
+  }
+  return sum / m_samples.size();
+}
+
+double FrameStats::min() const {
+  if (m_samples.empty()) {
+    return 0.0;
+  }
+  return *std::min_element(m_samples.begin(), m_samples.end());
+}
+
+double FrameStats::max() const {
+  if (m_samples.empty()) {
+    return 0.0;
+  }
+  return *std::max_element(m_samples.begin(), m_samples.end());
+}
+
+double FrameStats::percentile(double p) const {
+  if (m_samples.empty()) {
+    return 0.0;
+  }
+
+  /* Nearest-rank percentile */
+  m_sorted.assign(m_samples.begin(), m_samples.end());
+  const double rank = std::ceil(p / 100.0 * m_sorted.size());
+  size_t index = rank < 1.0 ? 0 : static_cast<size_t>(rank) - 1;
+  index = std::min(index, m_sorted.size() - 1);
+  std::nth_element(m_sorted.begin(), m_sorted.begin() + index,
+                   m_sorted.end());
+  return m_sorted[index];
+}
@@ -1,24 +1,37 @@
 #include <glm/vec2.hpp>
 
-#include <sstream>
 #include <string>
-#include <fstream>
-#include <unordered_map>
 #include <vector>
 
 #include "breakout/gamelevel.hpp"
 #include "breakout/gameobject.hpp"
 #include "breakout/log.hpp"
-#include "breakout/resource_manager.hpp"
+#include "breakout/memory.hpp"
+#include "breakout/resource_pack.hpp"
+
+/* Indexed by BlockType, solid blocks keep their texture's colors */
+static const glm::vec3 BLOCK_COLORS[] = {
+    glm::vec3(0.0f),             /* NOBLOCK */
+    glm::vec3(1.0f),             /* SOLID */
+    glm::vec3(0.2f, 0.6f, 1.0f), /* BLUE */
+    glm::vec3(0.0f, 0.7f, 0.0f), /* GREEN */
+    glm::vec3(0.8f, 0.8f, 0.4f), /* YELLOW */
+    glm::vec3(1.0f, 0.5f, 0.0f), /* ORANGE */
+};
+static const size_t BLOCK_COLOR_COUNT =
+    sizeof(BLOCK_COLORS) / sizeof(BLOCK_COLORS[0]);
 
 void GameLevel::init(TileData tile_data, uint32_t window_height,
-                     uint32_t level_width, uint32_t level_height) {
+                     uint32_t level_width, uint32_t level_height,
+                     const Sprites &sprites) {
   /* Calculate dimensions */
   uint32_t height = tile_data.size();
   uint32_t width = tile_data[0].size();
   float unit_width = level_width / static_cast<float>(width);
   float unit_height = level_height / static_cast<float>(height);
 
+  bool uses_block = false, uses_block_solid = false;
+
   /* Initialize level tiles based on tile data */
   for (uint32_t y = 0; y < height; ++y) {
     for (uint32_t x = 0; x < width; ++x) {
@@ -30,23 +43,27 @@ void GameLevel::init(TileData tile_data, uint32_t window_height,
       }
 
       if (block_type == BlockType::SOLID) {
-        m_bricks.emplace_back(pos, size,
-                              ResourceManager::texture("block_solid")),
+        uses_block_solid = true;
+        m_bricks.emplace_back(pos, size, sprites.block_solid),
             glm::vec3(0.8f, 0.8f, 0.7f);
         m_bricks.back().is_solid = true;
       } else {
-        std::unordered_map<BlockType, glm::vec3> color_map = {
-            {BlockType::BLUE, glm::vec3(0.2f, 0.6f, 1.0f)},
-            {BlockType::GREEN, glm::vec3(0.0f, 0.7f, 0.0f)},
-            {BlockType::YELLOW, glm::vec3(0.8f, 0.8f, 0.4f)},
-            {BlockType::ORANGE, glm::vec3(1.0f, 0.5f, 0.0f)},
-        };
-        glm::vec3 color = color_map[block_type];
-        m_bricks.emplace_back(pos, size, ResourceManager::texture("block"),
-                              color);
+        const size_t color_index = static_cast<size_t>(block_type);
+        const glm::vec3 color = color_index < BLOCK_COLOR_COUNT
+                                    ? BLOCK_COLORS[color_index]
+                                    : glm::vec3(0.0f);
+        uses_block = true;
+        m_bricks.emplace_back(pos, size, sprites.block, color);
       }
     }
   }
+
+  if (uses_block) {
+    m_textures.push_back(sprites.block);
+  }
+  if (uses_block_solid) {
+    m_textures.push_back(sprites.block_solid);
+  }
 }
 
 void GameLevel::draw(SpriteRenderer &renderer) {
@@ -66,32 +83,71 @@ bool GameLevel::is_completed() const {
   return true;
 }
 
-void GameLevel::load(const char *path, uint32_t window_height,
-                     uint32_t level_width, uint32_t level_height) {
-  m_bricks.clear();
+size_t GameLevel::bricks_remaining() const {
+  size_t count = 0;
+  for (const GameObject &tile : m_bricks) {
+    if (!tile.is_solid && !tile.is_destroyed) {
+      ++count;
+    }
+  }
+  return count;
+}
 
-  GameLevel level;
-  TileData tile_data;
-  uint32_t tile_code;
+/* Rows of whitespace separated tile codes, one row per line */
+static GameLevel::TileData parse_tiles(const char *data, size_t size) {
+  GameLevel::TileData tile_data;
+  std::vector<uint32_t> row;
+
+  const char *end = data + size;
+  for (const char *c = data; c < end;) {
+    if (*c >= '0' && *c <= '9') {
+      uint32_t tile_code = 0;
+      for (; c < end && *c >= '0' && *c <= '9'; ++c) {
+        tile_code = tile_code * 10 + (*c - '0');
+      }
+      row.push_back(tile_code);
+      continue;
+    }
 
-  std::string line;
-  std::ifstream file(path);
+    if (*c == '\n') {
+      tile_data.push_back(std::move(row));
+      row.clear();
+    }
+    ++c;
+  }
+  if (!row.empty()) {
+    tile_data.push_back(std::move(row));
+  }
+  return tile_data;
+}
 
-  if (!file) {
+void GameLevel::load(const char *path, uint32_t window_height,
+                     uint32_t level_width, uint32_t level_height,
+                     const Sprites &sprites) {
+  Memory::MappedFile file;
+  const Memory::FileView view = ResourcePack::open(path, file);
+  if (view.empty()) {
+    m_bricks.clear();
+    m_textures.clear();
     LOG_ERROR("Failed to load level at path: {}", path);
     return;
   }
 
-  while (std::getline(file, line)) {
-    std::istringstream sstream(line);
-    std::vector<uint32_t> row;
-    while (sstream >> tile_code) {
-      row.push_back(tile_code);
-    }
-    tile_data.push_back(std::move(row));
-  }
+  load_from_buffer(view.text(), view.size, window_height, level_width,
+                   level_height, sprites);
+}
+
+void GameLevel::load_from_buffer(const char *data, size_t size,
+                                 uint32_t window_height, uint32_t level_width,
+                                 uint32_t level_height,
+                                 const Sprites &sprites) {
+  m_bricks.clear();
+  m_textures.clear();
+
+  TileData tile_data = parse_tiles(data, size);
   if (tile_data.size() > 0) {
-    init(std::move(tile_data), window_height, level_width, level_height);
+    init(std::move(tile_data), window_height, level_width, level_height,
+         sprites);
   }
 }
 
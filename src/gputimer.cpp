@@ -0,0 +1,82 @@
+#ifdef BREAKOUT_PROFILER
+
+#include <glad/glad.h>
+
+#include "breakout/gpu_timer.hpp"
+
+namespace Profiler {
+
+GpuTimer::GpuTimer() : m_track(create_track("GPU")) {
+  for (Frame &frame : m_frames) {
+    glGenQueries(MAX_ZONES, frame.begin_queries);
+    glGenQueries(MAX_ZONES, frame.end_queries);
+  }
+
+  /* The GPU clock runs at the same rate but from another origin. Sampling
+   * it doesn't wait for queued commands, only for the driver round trip */
+  GLint64 gpu_time;
+  glGetInteger64v(GL_TIMESTAMP, &gpu_time);
+  m_clock_offset = static_cast<int64_t>(now()) - gpu_time;
+}
+
+GpuTimer::~GpuTimer() {
+  for (Frame &frame : m_frames) {
+    glDeleteQueries(MAX_ZONES, frame.begin_queries);
+    glDeleteQueries(MAX_ZONES, frame.end_queries);
+  }
+}
+
+void GpuTimer::begin_frame() {
+  Frame &frame = m_frames[++m_frame % FRAME_LATENCY];
+  collect(frame);
+  frame.zone_count = 0;
+}
+
+uint32_t GpuTimer::begin(const char *name) {
+  Frame &frame = m_frames[m_frame % FRAME_LATENCY];
+  if (frame.zone_count == MAX_ZONES) {
+    return INVALID_ZONE;
+  }
+
+  const uint32_t zone = frame.zone_count++;
+  frame.names[zone] = name;
+  glQueryCounter(frame.begin_queries[zone], GL_TIMESTAMP);
+  frame.last_query = frame.begin_queries[zone];
+  return zone;
+}
+
+void GpuTimer::end(uint32_t zone) {
+  if (zone == INVALID_ZONE) {
+    return;
+  }
+
+  Frame &frame = m_frames[m_frame % FRAME_LATENCY];
+  glQueryCounter(frame.end_queries[zone], GL_TIMESTAMP);
+  frame.last_query = frame.end_queries[zone];
+}
+
+void GpuTimer::collect(Frame &frame) {
+  if (frame.zone_count == 0) {
+    return;
+  }
+
+  GLint available = GL_FALSE;
+  glGetQueryObjectiv(frame.last_query, GL_QUERY_RESULT_AVAILABLE, &available);
+  if (!available) {
+    ++m_dropped_frames;
+    return;
+  }
+
+  for (uint32_t zone = 0; zone < frame.zone_count; ++zone) {
+    GLuint64 begin, end;
+    glGetQueryObjectui64v(frame.begin_queries[zone], GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(frame.end_queries[zone], GL_QUERY_RESULT, &end);
+    record(m_track, frame.names[zone],
+           static_cast<uint64_t>(static_cast<int64_t>(begin) + m_clock_offset),
+           static_cast<uint64_t>(static_cast<int64_t>(end) + m_clock_offset));
+  }
+}
+
+} // namespace Profiler
+
+#endif /* BREAKOUT_PROFILER */
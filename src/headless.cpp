@@ -0,0 +1,254 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "breakout/audio.hpp"
+#include "breakout/breakout_game.hpp"
+#include "breakout/frame_stats.hpp"
+#include "breakout/headless.hpp"
+#include "breakout/input.hpp"
+#include "breakout/log.hpp"
+
+namespace Headless {
+
+/* Frames are simulated at a fixed rate so that runs are comparable */
+static const float FIXED_DELTA_TIME = 1.0f / 60.0f;
+/* Number of frames a GPU timer query is given before its result is read */
+static const size_t QUERY_LATENCY = 3;
+
+bool SessionRecorder::open(const char *path, double start_time) {
+  m_file.open(path);
+  if (!m_file) {
+    LOG_ERROR("Failed to open session file for writing: {}", path);
+    return false;
+  }
+  m_start_time = start_time;
+  return true;
+}
+
+void SessionRecorder::record(double time, KeyCode key, bool pressed) {
+  if (!m_file) {
+    return;
+  }
+  m_file << time - m_start_time << ' ' << static_cast<int>(key) << ' '
+         << (pressed ? 1 : 0) << '\n';
+}
+
+std::vector<SessionEvent> load_session(const char *path) {
+  std::vector<SessionEvent> events;
+
+  std::ifstream file(path);
+  if (!file) {
+    LOG_ERROR("Failed to load session at path: {}", path);
+    return events;
+  }
+
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream sstream(line);
+    double time;
+    int key, pressed;
+    if (sstream >> time >> key >> pressed) {
+      events.push_back({time, static_cast<KeyCode>(key), pressed != 0});
+    }
+  }
+
+  std::stable_sort(events.begin(), events.end(),
+                   [](const SessionEvent &a, const SessionEvent &b) {
+                     return a.time < b.time;
+                   });
+  return events;
+}
+
+/* Without a recorded session just start the first level and launch the ball */
+static std::vector<SessionEvent> default_session() {
+  return {
+      {0.00, KeyCode::KEY_ENTER, true},
+      {0.05, KeyCode::KEY_ENTER, false},
+      {0.10, KeyCode::KEY_SPACE, true},
+      {0.15, KeyCode::KEY_SPACE, false},
+  };
+}
+
+static void dump_frame(const char *dir, uint32_t frame, int width,
+                       int height) {
+  std::vector<unsigned char> pixels(static_cast<size_t>(width) * height * 3);
+
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadBuffer(GL_BACK);
+  glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+  char path[512];
+  std::snprintf(path, sizeof(path), "%s/frame_%05u.ppm", dir, frame);
+
+  std::ofstream file(path, std::ios::binary);
+  if (!file) {
+    LOG_ERROR("Failed to dump frame to path: {}", path);
+    return;
+  }
+
+  file << "P6\n" << width << ' ' << height << "\n255\n";
+  /* OpenGL stores rows bottom to top */
+  const size_t row_size = static_cast<size_t>(width) * 3;
+  for (int y = height - 1; y >= 0; --y) {
+    file.write(reinterpret_cast<const char *>(&pixels[y * row_size]),
+               row_size);
+  }
+}
+
+static void print_stats(const char *name, const FrameStats &stats) {
+  std::printf("%s frame time (ms): avg %.3f min %.3f p50 %.3f p90 %.3f "
+              "p99 %.3f max %.3f\n",
+              name, stats.average(), stats.min(), stats.percentile(50.0),
+              stats.percentile(90.0), stats.percentile(99.0), stats.max());
+}
+
+int run(GLFWwindow *window, BreakoutGame &game, const Options &options) {
+  const std::vector<SessionEvent> session =
+      options.session_path ? load_session(options.session_path)
+                           : default_session();
+
+  int width, height;
+  glfwGetFramebufferSize(window, &width, &height);
+
+  FrameStats cpu_stats, gpu_stats;
+  cpu_stats.reserve(options.frames);
+  gpu_stats.reserve(options.frames);
+
+  GLuint queries[QUERY_LATENCY];
+  glGenQueries(QUERY_LATENCY, queries);
+
+  size_t next_event = 0;
+  for (uint32_t frame = 0; frame < options.frames; ++frame) {
+    const double time = frame * FIXED_DELTA_TIME;
+    for (; next_event < session.size() && session[next_event].time <= time;
+         ++next_event) {
+      const SessionEvent &event = session[next_event];
+      game.input().push_event(event.time, event.key, event.pressed);
+    }
+    game.input().apply_events(time);
+
+    /* Collect the query issued QUERY_LATENCY frames ago */
+    GLuint query = queries[frame % QUERY_LATENCY];
+    if (frame >= QUERY_LATENCY) {
+      GLuint64 elapsed;
+      glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+      gpu_stats.add(elapsed / 1e6);
+    }
+
+    const double cpu_begin = glfwGetTime();
+    glBeginQuery(GL_TIME_ELAPSED, query);
+
+    game.process_input(FIXED_DELTA_TIME);
+    if (game.is_simulating()) {
+      game.update(FIXED_DELTA_TIME);
+    }
+
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    game.render();
+
+    glEndQuery(GL_TIME_ELAPSED);
+    cpu_stats.add((glfwGetTime() - cpu_begin) * 1000.0);
+
+    if (options.dump_dir) {
+      dump_frame(options.dump_dir, frame, width, height);
+    }
+    glfwSwapBuffers(window);
+  }
+
+  /* Drain queries that are still in flight */
+  const uint32_t pending = std::min<uint32_t>(options.frames, QUERY_LATENCY);
+  for (uint32_t frame = options.frames - pending; frame < options.frames;
+       ++frame) {
+    GLuint64 elapsed;
+    glGetQueryObjectui64v(queries[frame % QUERY_LATENCY], GL_QUERY_RESULT,
+                          &elapsed);
+    gpu_stats.add(elapsed / 1e6);
+  }
+  glDeleteQueries(QUERY_LATENCY, queries);
+
+  std::printf("renderer: %s\n", glGetString(GL_RENDERER));
+  std::printf("frames: %u\n", options.frames);
+  print_stats("cpu", cpu_stats);
+  print_stats("gpu", gpu_stats);
+  return 0;
+}
+
+int run_audio_benchmark(const Options &options) {
+  static const char *const EFFECTS[] = {
+      "res/audio/bleep.wav",
+      "res/audio/solid.wav",
+      "res/audio/powerup.wav",
+      "res/audio/bleep.mp3",
+  };
+
+  AudioEngine engine(AudioBackend::OFFLINE);
+  if (!engine.is_initialized()) {
+    return 1;
+  }
+
+  /* Reserve more voices than can be mixed so the mixer stays saturated */
+  EffectOptions effect_options;
+  effect_options.max_voices = AudioEngine::MAX_PLAYING;
+  std::vector<SoundHandle> effects;
+  for (const char *path : EFFECTS) {
+    const SoundHandle effect = engine.load_effect(path, effect_options);
+    if (effect.is_valid()) {
+      effects.push_back(effect);
+    }
+  }
+  if (effects.empty()) {
+    LOG_ERROR("No sound effects to benchmark");
+    return 1;
+  }
+
+  const uint32_t frames_per_second =
+      static_cast<uint32_t>(1.0f / FIXED_DELTA_TIME + 0.5f);
+  FrameStats mix_stats;
+  mix_stats.reserve(options.frames / frames_per_second + 1);
+
+  double second_time = 0.0;
+  size_t voice_samples = 0;
+  for (uint32_t frame = 0; frame < options.frames; ++frame) {
+    engine.begin_tick();
+    engine.play(effects[frame % effects.size()]);
+    voice_samples += engine.playing_voices();
+
+    const std::chrono::steady_clock::time_point begin =
+        std::chrono::steady_clock::now();
+    engine.advance(FIXED_DELTA_TIME);
+    second_time += std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - begin)
+                       .count();
+
+    if ((frame + 1) % frames_per_second == 0) {
+      mix_stats.add(second_time);
+      second_time = 0.0;
+    }
+  }
+
+  std::printf("audio: %u Hz, %u channels, %zu effects\n",
+              AudioEngine::OFFLINE_SAMPLE_RATE,
+              AudioEngine::OFFLINE_CHANNELS, effects.size());
+  std::printf("simulated seconds: %zu\n", mix_stats.count());
+  std::printf("average voices: %.2f\n",
+              options.frames ? static_cast<double>(voice_samples) /
+                                   options.frames
+                             : 0.0);
+  std::printf("mix time per simulated second (ms): avg %.3f min %.3f "
+              "p50 %.3f p90 %.3f max %.3f\n",
+              mix_stats.average(), mix_stats.min(),
+              mix_stats.percentile(50.0), mix_stats.percentile(90.0),
+              mix_stats.max());
+  return 0;
+}
+
+} // namespace Headless
@@ -2,10 +2,7 @@
 
 #include "breakout/input.hpp"
 
-Input::KeyArray Input::m_keys = {{{false, false}}};
-Input::MouseArray Input::m_mouse = {false};
-
-bool Input::is_key_pressed(const KeyCode key_code) {
+bool Input::is_key_pressed(const KeyCode key_code) const {
   if (!key_is_safe(key_code)) {
     return false;
   }
@@ -19,7 +16,7 @@ void Input::press_key(const KeyCode key_code) {
   m_keys[static_cast<size_t>(key_code)].pressed = true;
 }
 
-bool Input::is_key_processed(const KeyCode key_code) {
+bool Input::is_key_processed(const KeyCode key_code) const {
   if (!key_is_safe(key_code)) {
     return false;
   }
@@ -47,7 +44,63 @@ void Input::key_unset_proccessed(const KeyCode key_code) {
   m_keys[static_cast<size_t>(key_code)].processed = false;
 }
 
-bool Input::is_mouse_button_pressed(const MouseButtonCode mb_code) {
+void Input::push_event(double time, const KeyCode key_code, bool pressed) {
+  if (!key_is_safe(key_code)) {
+    return;
+  }
+
+  if (m_event_count == EVENT_CAPACITY) {
+    const Event &oldest = m_events[m_event_head];
+    if (oldest.pressed) {
+      press_key(oldest.key);
+    } else {
+      release_key(oldest.key);
+    }
+    m_event_head = (m_event_head + 1) % EVENT_CAPACITY;
+    --m_event_count;
+  }
+  m_events[(m_event_head + m_event_count) % EVENT_CAPACITY] = {time, key_code,
+                                                               pressed};
+  ++m_event_count;
+}
+
+void Input::apply_events(double time) {
+  ++m_apply_count;
+  for (; m_event_count > 0; --m_event_count) {
+    const Event &event = m_events[m_event_head];
+    if (event.time > time) {
+      break;
+    }
+
+    Key &key = m_keys[static_cast<size_t>(event.key)];
+    if (event.pressed) {
+      press_key(event.key);
+      key.pressed_in = m_apply_count;
+    } else if (key.pressed && key.pressed_in == m_apply_count) {
+      /* Later events wait as well to stay in order */
+      break;
+    } else {
+      release_key(event.key);
+    }
+
+    if (!m_has_applied_time) {
+      m_applied_time = event.time;
+      m_has_applied_time = true;
+    }
+    m_event_head = (m_event_head + 1) % EVENT_CAPACITY;
+  }
+}
+
+bool Input::pop_applied_time(double &time) {
+  if (!m_has_applied_time) {
+    return false;
+  }
+  time = m_applied_time;
+  m_has_applied_time = false;
+  return true;
+}
+
+bool Input::is_mouse_button_pressed(const MouseButtonCode mb_code) const {
   return m_mouse[static_cast<size_t>(mb_code)];
 }
 
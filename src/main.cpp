@@ -1,21 +1,172 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <unordered_map>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
-
+#include "breakout/audio.hpp"
 #include "breakout/breakout_game.hpp"
+#include "breakout/frame_stats.hpp"
+#include "breakout/headless.hpp"
 #include "breakout/input.hpp"
 #include "breakout/log.hpp"
 #include "breakout/macro.hpp"
+#include "breakout/profiler.hpp"
 #include "breakout/resource_manager.hpp"
+#include "breakout/resource_pack.hpp"
 
 const uint32_t SCREEN_WIDTH = 800;
 const uint32_t SCREEN_HEIGHT = 600;
 
+/* Frame pacing while nothing moves on its own (menus, paused game) */
+const double IDLE_FRAME_TIME = 1.0 / 30.0;
+const double UNFOCUSED_FRAME_TIME = 1.0 / 10.0;
+/* The simulation advances in fixed steps, independent of the frame rate */
+const double SIMULATION_TICK = 1.0 / 120.0;
+/* Time the simulation catches up on after a stall before it skips ahead */
+const double MAX_CATCH_UP_TIME = 0.25;
+
+struct WindowState {
+  bool focused = true;
+  bool iconified = false;
+  /* Something happened since the last presented frame */
+  bool dirty = true;
+};
+
+static WindowState window_state;
+
+/* Input latency without stalling the pipeline: a fence is queued behind the
+ * frame showing an input and polled on later frames. It tells when the GPU
+ * finished the frame, scan-out isn't included, and the resolution is that
+ * of the main loop */
+struct LatencyProbe {
+  static const size_t MAX_PENDING = 4;
+
+  struct Pending {
+    GLsync fence;
+    double event_time;
+  };
+
+  Pending pending[MAX_PENDING];
+  size_t pending_count = 0;
+  FrameStats stats;
+
+  /* Right after the frame showing an input that happened at `event_time` */
+  void submit(double event_time) {
+    if (pending_count == MAX_PENDING) {
+      /* The GPU is far behind, skip this sample rather than wait */
+      return;
+    }
+    pending[pending_count++] = {
+        glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), event_time};
+  }
+
+  void poll(double now) {
+    /* Fences signal in order */
+    size_t done = 0;
+    for (; done < pending_count; ++done) {
+      const GLenum status =
+          glClientWaitSync(pending[done].fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+      if (status != GL_ALREADY_SIGNALED &&
+          status != GL_CONDITION_SATISFIED) {
+        break;
+      }
+      stats.add((now - pending[done].event_time) * 1000.0);
+      glDeleteSync(pending[done].fence);
+    }
+    std::copy(pending + done, pending + pending_count, pending);
+    pending_count -= done;
+  }
+
+  void clear() {
+    for (size_t i = 0; i < pending_count; ++i) {
+      glDeleteSync(pending[i].fence);
+    }
+    pending_count = 0;
+  }
+};
+
+struct LaunchOptions {
+  bool headless = false;
+  Headless::Options headless_options;
+  /* Record key events of a windowed session for later headless replay */
+  const char *record_path = nullptr;
+  /* Assets not found in the pack are read from res/ */
+  const char *pack_path = "breakout.pack";
+  size_t texture_budget = ResourceManager::DEFAULT_TEXTURE_BUDGET;
+  /* Headless runs default to the offline backend */
+  AudioBackend audio_backend = AudioBackend::DEVICE;
+  bool audio_benchmark = false;
+  /* Chrome trace of the last recorded zones, written on exit */
+  const char *trace_path = nullptr;
+  /* Start with the statistics overlay shown */
+  bool show_stats = false;
+  /* Measure the time from an input to the end of the frame showing it */
+  bool measure_latency = false;
+};
+
+static Headless::SessionRecorder session_recorder;
+
+static LaunchOptions parse_options(int argc, char *argv[]) {
+  LaunchOptions options;
+  bool audio_selected = false;
+  for (int i = 1; i < argc; ++i) {
+    const bool has_value = i + 1 < argc;
+    if (!std::strcmp(argv[i], "--headless")) {
+      options.headless = true;
+    } else if (!std::strcmp(argv[i], "--frames") && has_value) {
+      options.headless_options.frames = std::strtoul(argv[++i], nullptr, 10);
+    } else if (!std::strcmp(argv[i], "--session") && has_value) {
+      options.headless_options.session_path = argv[++i];
+    } else if (!std::strcmp(argv[i], "--dump-frames") && has_value) {
+      options.headless_options.dump_dir = argv[++i];
+    } else if (!std::strcmp(argv[i], "--record") && has_value) {
+      options.record_path = argv[++i];
+    } else if (!std::strcmp(argv[i], "--pack") && has_value) {
+      options.pack_path = argv[++i];
+    } else if (!std::strcmp(argv[i], "--texture-budget") && has_value) {
+      /* In MiB, 0 disables eviction */
+      options.texture_budget =
+          std::strtoull(argv[++i], nullptr, 10) * 1024 * 1024;
+    } else if (!std::strcmp(argv[i], "--audio") && has_value) {
+      const char *backend = argv[++i];
+      audio_selected = true;
+      if (!std::strcmp(backend, "device")) {
+        options.audio_backend = AudioBackend::DEVICE;
+      } else if (!std::strcmp(backend, "offline")) {
+        options.audio_backend = AudioBackend::OFFLINE;
+      } else if (!std::strcmp(backend, "none")) {
+        options.audio_backend = AudioBackend::DISABLED;
+      } else {
+        LOG_WARN("Unknown audio backend: {}", backend);
+        audio_selected = false;
+      }
+    } else if (!std::strcmp(argv[i], "--audio-bench")) {
+      options.audio_benchmark = true;
+    } else if (!std::strcmp(argv[i], "--stats")) {
+      options.show_stats = true;
+    } else if (!std::strcmp(argv[i], "--latency")) {
+      options.measure_latency = true;
+    } else if (!std::strcmp(argv[i], "--trace") && has_value) {
+      options.trace_path = argv[++i];
+#ifndef BREAKOUT_PROFILER
+      LOG_WARN("Built without BREAKOUT_PROFILER, no trace will be written");
+#endif /* BREAKOUT_PROFILER */
+    } else {
+      LOG_WARN("Unknown command line option: {}", argv[i]);
+    }
+  }
+  if (options.headless && !audio_selected) {
+    options.audio_backend = AudioBackend::OFFLINE;
+  }
+  return options;
+}
+
 const char *gl_source_to_string(const GLenum source) {
   switch (source) {
   case GL_DEBUG_SOURCE_API:
@@ -92,11 +243,46 @@ void gl_debug_handle(GLenum source, GLenum type, GLuint id, GLenum severity,
   }
 }
 
+static void write_trace(const LaunchOptions &options) {
+#ifdef BREAKOUT_PROFILER
+  if (options.trace_path) {
+    Profiler::write_trace(options.trace_path);
+  }
+#else
+  YU_UNUSED(options);
+#endif /* BREAKOUT_PROFILER */
+}
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
 int main(int argc, char *argv[]) {
-  YU_UNUSED(argc);
-  YU_UNUSED(argv);
+  const std::chrono::steady_clock::time_point launch_time =
+      std::chrono::steady_clock::now();
+  const LaunchOptions options = parse_options(argc, argv);
+#ifdef BREAKOUT_PROFILER
+  Profiler::set_thread_name("main");
+#endif /* BREAKOUT_PROFILER */
+  if (ResourcePack::mount(options.pack_path)) {
+    LOG_INFO("Mounted resource pack: {}", options.pack_path);
+  }
+  ResourceManager::set_texture_budget(options.texture_budget);
 
-  BreakoutGame Breakout(SCREEN_WIDTH, SCREEN_HEIGHT);
+  if (options.audio_benchmark) {
+    return Headless::run_audio_benchmark(options.headless_options);
+  }
+
+  BreakoutGame Breakout(SCREEN_WIDTH, SCREEN_HEIGHT, options.audio_backend);
+
+#ifdef GLFW_PLATFORM_NULL
+  /* Don't require a display server for offscreen rendering */
+  if (options.headless) {
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+  }
+#endif /* GLFW_PLATFORM_NULL */
 
   glfwInit();
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
@@ -111,8 +297,19 @@ int main(int argc, char *argv[]) {
 #endif /* __APPLE__ */
 
   glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+  if (options.headless) {
+    /* Software rendering (e.g. llvmpipe) into an invisible surface */
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+  }
   GLFWwindow *window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Breakout",
                                         nullptr, nullptr);
+  if (!window && options.headless) {
+    LOG_WARN("Failed to create OSMesa context, falling back to EGL");
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+    window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Breakout", nullptr,
+                              nullptr);
+  }
   if (!window) {
     LOG_CRITICAL("Failed to create window");
     glfwTerminate();
@@ -126,29 +323,55 @@ int main(int argc, char *argv[]) {
     return -1;
   }
 
+  /* Input goes to the game the window shows */
+  glfwSetWindowUserPointer(window, &Breakout);
   glfwSetKeyCallback(window,
                      [](GLFWwindow *window, int key, int scancode, int action,
                         int mods) -> void {
-                       YU_UNUSED(window);
-                       YU_UNUSED(key);
                        YU_UNUSED(scancode);
                        YU_UNUSED(mods);
-                       switch (action) {
-                       case GLFW_PRESS:
-                         Input::press_key(static_cast<KeyCode>(key));
-                         break;
-                       case GLFW_RELEASE:
-                         Input::release_key(static_cast<KeyCode>(key));
-                         break;
+                       window_state.dirty = true;
+                       if (action == GLFW_REPEAT) {
+                         return;
                        }
+                       BreakoutGame *game = static_cast<BreakoutGame *>(
+                           glfwGetWindowUserPointer(window));
+                       /* Applied by the tick this time falls into */
+                       const double time = glfwGetTime();
+                       const bool pressed = action == GLFW_PRESS;
+                       game->input().push_event(
+                           time, static_cast<KeyCode>(key), pressed);
+                       session_recorder.record(
+                           time, static_cast<KeyCode>(key), pressed);
                      });
 
   glfwSetFramebufferSizeCallback(
       window, [](GLFWwindow *window, int width, int height) -> void {
         YU_UNUSED(window);
+        window_state.dirty = true;
         glViewport(0, 0, width, height);
       });
 
+  glfwSetWindowFocusCallback(window,
+                             [](GLFWwindow *window, int focused) -> void {
+                               YU_UNUSED(window);
+                               window_state.focused = focused == GLFW_TRUE;
+                               window_state.dirty = true;
+                             });
+
+  glfwSetWindowIconifyCallback(window,
+                               [](GLFWwindow *window, int iconified) -> void {
+                                 YU_UNUSED(window);
+                                 window_state.iconified =
+                                     iconified == GLFW_TRUE;
+                                 window_state.dirty = true;
+                               });
+
+  glfwSetWindowRefreshCallback(window, [](GLFWwindow *window) -> void {
+    YU_UNUSED(window);
+    window_state.dirty = true;
+  });
+
 #ifndef NDEBUG
 
   /* Check if we properly initialized OpenGL's debug context */
@@ -170,26 +393,115 @@ int main(int argc, char *argv[]) {
   glEnable(GL_BLEND);
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
+  LOG_INFO("Created window and context in {:.2f} ms", elapsed_ms(launch_time));
+  const std::chrono::steady_clock::time_point init_time =
+      std::chrono::steady_clock::now();
   Breakout.init();
-  float delta_time = 0.0f;
-  float next_frame = 0.0f;
-  while (!glfwWindowShouldClose(window)) {
-    float current_frame = glfwGetTime();
+  Breakout.set_stats_visible(options.show_stats);
+  LOG_INFO("Initialized game in {:.2f} ms", elapsed_ms(init_time));
+
+  if (options.headless) {
+    const int status =
+        Headless::run(window, Breakout, options.headless_options);
+    write_trace(options);
+    ResourceManager::clear();
+    glfwTerminate();
+    return status;
+  }
+
+  if (options.record_path) {
+    session_recorder.open(options.record_path, glfwGetTime());
+  }
 
-    Breakout.process_input(delta_time);
-    Breakout.update(delta_time);
+  ResourceManager::watch_resources();
 
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
-    Breakout.render();
+  bool first_frame = true;
+  double simulation_time = glfwGetTime();
+  LatencyProbe latency;
+  while (!glfwWindowShouldClose(window)) {
+    /* Nothing is visible, sleep until the window is restored */
+    if (window_state.iconified) {
+      glfwWaitEvents();
+      continue;
+    }
+
+    /* The simulation is paused while the window is out of focus */
+    const bool simulating = window_state.focused && Breakout.is_simulating();
+    if (!simulating) {
+      /* Wake up on input or at a low tick rate for animated effects. Input
+       * that arrived within the last tick is applied by the next one, so
+       * don't sleep past it */
+      const double timeout =
+          Breakout.input().has_pending_events() ? SIMULATION_TICK
+          : window_state.focused               ? IDLE_FRAME_TIME
+                                               : UNFOCUSED_FRAME_TIME;
+      glfwWaitEventsTimeout(timeout);
+    }
 
-    next_frame = glfwGetTime();
-    delta_time = next_frame - current_frame;
+    /* Rebuilt programs are swapped in once the driver is done with them.
+     * Only drivers without KHR_parallel_shader_compile make this wait for a
+     * link, one frame after the change was picked up */
+    if (Breakout.hot_reload()) {
+      window_state.dirty = true;
+    }
 
+    /* Latch input as late as possible, right before it is simulated */
     glfwPollEvents();
-    glfwSwapBuffers(window);
+    const double now = glfwGetTime();
+    if (now - simulation_time > MAX_CATCH_UP_TIME) {
+      simulation_time = now - SIMULATION_TICK;
+    }
+
+    /* Every tick sees exactly the events that happened before its end */
+    for (; simulation_time + SIMULATION_TICK <= now;
+         simulation_time += SIMULATION_TICK) {
+      Breakout.input().apply_events(simulation_time + SIMULATION_TICK);
+      Breakout.process_input(SIMULATION_TICK);
+      if (simulating) {
+        Breakout.update(SIMULATION_TICK);
+      }
+    }
+
+    /* Don't present a frame that would look exactly like the previous one.
+     * Input applied by the ticks above may have changed the menus even
+     * though nothing is simulated */
+    double event_time;
+    const bool applied_input = Breakout.input().pop_applied_time(event_time);
+    const bool redraw = simulating || applied_input || window_state.dirty ||
+                        Breakout.is_animated();
+    window_state.dirty = false;
+
+    if (redraw) {
+      glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+      glClear(GL_COLOR_BUFFER_BIT);
+      Breakout.render();
+      glfwSwapBuffers(window);
+
+      if (applied_input && options.measure_latency) {
+        latency.submit(event_time);
+      }
+    }
+    if (options.measure_latency) {
+      latency.poll(glfwGetTime());
+    }
+
+    if (first_frame) {
+      LOG_INFO("Time from launch to first frame: {:.2f} ms",
+               elapsed_ms(launch_time));
+      first_frame = false;
+    }
+  }
+
+  latency.clear();
+  if (latency.stats.count() > 0) {
+    std::printf("input to frame latency (ms): avg %.3f p50 %.3f p90 %.3f "
+                "max %.3f over %zu inputs\n",
+                latency.stats.average(), latency.stats.percentile(50.0),
+                latency.stats.percentile(90.0), latency.stats.max(),
+                latency.stats.count());
   }
 
+  write_trace(options);
   ResourceManager::clear();
   glfwTerminate();
   return 0;
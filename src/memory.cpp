@@ -1,18 +1,166 @@
+#include <algorithm>
 #include <fstream>
-#include <sstream>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif /* _WIN32 */
+
+#include <cerrno>
+#include <cstdlib>
+#include <new>
 
 #include "breakout/memory.hpp"
-#include "breakout/log.hpp"
+
+/* Plain counters, so that they are usable before any constructor runs */
+static thread_local uint64_t thread_allocation_count = 0;
+static thread_local uint64_t thread_allocation_bytes = 0;
+
+/* The array and nothrow forms call these by default */
+void *operator new(size_t size) {
+  ++thread_allocation_count;
+  thread_allocation_bytes += size;
+  for (;;) {
+    if (void *memory = std::malloc(size ? size : 1)) {
+      return memory;
+    }
+    std::new_handler handler = std::get_new_handler();
+    if (!handler) {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+
+void operator delete(void *memory, size_t) noexcept { std::free(memory); }
 
 namespace Memory {
-std::string read_file(const std::string &filepath) {
-  std::ifstream file(filepath, std::ios::binary);
+AllocationCount thread_allocations() {
+  AllocationCount count;
+  count.allocations = thread_allocation_count;
+  count.bytes = thread_allocation_bytes;
+  return count;
+}
+
+bool create_directory(const char *path) {
+#ifdef _WIN32
+  const int result = _mkdir(path);
+#else
+  const int result = mkdir(path, 0755);
+#endif /* _WIN32 */
+  return result == 0 || errno == EEXIST;
+}
+
+void *Arena::allocate(size_t size, size_t alignment) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (!m_blocks.empty()) {
+    Block &block = m_blocks.back();
+    const size_t offset = (m_used + alignment - 1) & ~(alignment - 1);
+    if (offset + size <= block.capacity) {
+      m_used = offset + size;
+      return block.data.get() + offset;
+    }
+  }
+
+  /* new[] storage is aligned for any fundamental type */
+  const size_t capacity = std::max(size, m_block_size);
+  m_blocks.push_back({std::unique_ptr<unsigned char[]>(
+                          new unsigned char[capacity]),
+                      capacity});
+  m_used = size;
+  return m_blocks.back().data.get();
+}
+
+void Arena::reset() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_blocks.clear();
+  m_used = 0;
+}
+
+MappedFile::~MappedFile() { close(); }
+
+bool MappedFile::open(const char *path, Arena *arena) {
+  close();
+
+#ifndef _WIN32
+  int fd = ::open(path, O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    /* Reserve at least one zeroed byte past the end of the file, so that the
+     * view is NUL-terminated even if the file fills its last page */
+    const size_t size = static_cast<size_t>(st.st_size);
+    const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t mapped_size = (size / page_size + 1) * page_size;
+    void *base = mmap(nullptr, mapped_size, PROT_READ,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base != MAP_FAILED) {
+      void *data =
+          mmap(base, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+      if (data != MAP_FAILED) {
+        m_view.data = static_cast<const unsigned char *>(data);
+        m_view.size = size;
+        m_mapped_size = mapped_size;
+      } else {
+        munmap(base, mapped_size);
+      }
+    }
+  }
+  ::close(fd);
+
+  if (m_mapped_size) {
+    return true;
+  }
+#endif /* !_WIN32 */
+
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
   if (!file) {
-    LOG_ERROR("Failed to open file at path: {}", filepath);
-    return "";
+    return false;
+  }
+  const size_t size = static_cast<size_t>(file.tellg());
+  if (size == 0) {
+    return false;
+  }
+
+  unsigned char *data;
+  if (arena) {
+    data = static_cast<unsigned char *>(arena->allocate(size + 1));
+  } else {
+    m_buffer.resize(size + 1);
+    data = m_buffer.data();
+  }
+  file.seekg(0);
+  file.read(reinterpret_cast<char *>(data), size);
+  if (!file) {
+    m_buffer.clear();
+    return false;
+  }
+  data[size] = '\0';
+
+  m_view.data = data;
+  m_view.size = size;
+  return true;
+}
+
+void MappedFile::close() {
+#ifndef _WIN32
+  if (m_mapped_size) {
+    munmap(const_cast<unsigned char *>(m_view.data), m_mapped_size);
   }
-  std::stringstream ss;
-  ss << file.rdbuf();
-  return ss.str();
+#endif /* !_WIN32 */
+  m_buffer.clear();
+  m_buffer.shrink_to_fit();
+  m_view = FileView();
+  m_mapped_size = 0;
 }
 } // namespace Memory
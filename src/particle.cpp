@@ -1,12 +1,13 @@
 #include <glad/glad.h>
 
 #include "breakout/particle.hpp"
+#include "breakout/resource_manager.hpp"
 #include "breakout/shader.hpp"
 #include "breakout/texture2d.hpp"
 #include "breakout/gameobject.hpp"
 
 ParticleGenerator::ParticleGenerator(std::shared_ptr<Shader> shader,
-                                     std::shared_ptr<Texture2D> texture,
+                                     TextureHandle texture,
                                      size_t amount)
     : m_num_particles(amount), m_shader(shader), m_texture(texture) {
   init();
@@ -34,24 +35,43 @@ void ParticleGenerator::update(float dt, GameObject &object,
 }
 
 void ParticleGenerator::draw() const {
+  Texture2D *texture = ResourceManager::texture(m_texture);
+  if (!texture) {
+    return;
+  }
   glBlendFunc(GL_SRC_ALPHA, GL_ONE);
 
   m_shader->bind();
+  texture->bind();
+  m_stats.state_changes += 4;
   for (const Particle &particle : m_particles) {
     if (particle.life > 0.0f) {
       m_shader->setvec2f("offset", particle.pos);
       m_shader->setvec4f("color", particle.color);
-      m_texture->bind();
 
       glBindVertexArray(m_vao);
       glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
       glBindVertexArray(0);
+
+      m_stats.draw_calls += 1;
+      m_stats.state_changes += 2;
+      m_stats.vertices += 4;
     }
   }
 
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
+size_t ParticleGenerator::live_particles() const {
+  size_t count = 0;
+  for (const Particle &particle : m_particles) {
+    if (particle.life > 0.0f) {
+      ++count;
+    }
+  }
+  return count;
+}
+
 void ParticleGenerator::init() {
   const float particle_quad[] = {
       // pos      // tex
@@ -88,8 +108,8 @@ const Particle &ParticleGenerator::first_unused_particle() const {
 
 void ParticleGenerator::respawn_particle(Particle &particle, GameObject &object,
                                          glm::vec2 offset) {
-  float random = ((rand() % 100) - 50) / 10.0f;
-  float r_color = 0.5f + ((rand() % 100) / 100.0f);
+  float random = (static_cast<int>(m_random() % 100) - 50) / 10.0f;
+  float r_color = 0.5f + ((m_random() % 100) / 100.0f);
   particle.pos = object.position + random + offset;
   particle.color = glm::vec4(r_color, r_color, r_color, 1.0f);
   particle.life = 1.0f;
@@ -78,6 +78,7 @@ void PostProcessor::begin_render() {
   glBindFramebuffer(GL_FRAMEBUFFER, m_msfbo);
   glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
   glClear(GL_COLOR_BUFFER_BIT);
+  m_stats.state_changes += 1;
 }
 
 void PostProcessor::end_render() {
@@ -86,6 +87,9 @@ void PostProcessor::end_render() {
   glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height,
                     GL_COLOR_BUFFER_BIT, GL_NEAREST);
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  /* The resolve blit counts as a draw */
+  m_stats.draw_calls += 1;
+  m_stats.state_changes += 3;
 }
 
 static const char *effect_type_to_str(PostProcessor::Effect effect) {
@@ -113,6 +117,10 @@ void PostProcessor::render(float time) {
   glBindVertexArray(m_vao);
   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
   glBindVertexArray(0);
+
+  m_stats.draw_calls += 1;
+  m_stats.state_changes += 5;
+  m_stats.vertices += 4;
 }
 
 void PostProcessor::init_render_data() {
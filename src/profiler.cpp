@@ -0,0 +1,148 @@
+#ifdef BREAKOUT_PROFILER
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "breakout/log.hpp"
+#include "breakout/profiler.hpp"
+
+namespace Profiler {
+
+struct Event {
+  const char *name;
+  uint64_t start;
+  uint64_t end;
+};
+
+struct Track {
+  uint32_t id = 0;
+  std::atomic<const char *> name{nullptr};
+  /* Number of events ever recorded, only its owner writes it */
+  std::atomic<uint64_t> written{0};
+  Event events[EVENT_CAPACITY];
+};
+
+static const std::chrono::steady_clock::time_point epoch =
+    std::chrono::steady_clock::now();
+
+/* Tracks outlive their threads so that a capture still shows them */
+static std::mutex registry_mutex;
+static std::vector<std::unique_ptr<Track>> registry;
+static thread_local Track *local_track = nullptr;
+
+Track *create_track(const char *name) {
+  std::unique_ptr<Track> track = std::make_unique<Track>();
+  track->name.store(name, std::memory_order_relaxed);
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  track->id = static_cast<uint32_t>(registry.size()) + 1;
+  registry.push_back(std::move(track));
+  return registry.back().get();
+}
+
+static Track &thread_track() {
+  if (!local_track) {
+    local_track = create_track(nullptr);
+  }
+  return *local_track;
+}
+
+uint64_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - epoch)
+      .count();
+}
+
+void record(Track *track, const char *name, uint64_t start, uint64_t end) {
+  const uint64_t index = track->written.load(std::memory_order_relaxed);
+  track->events[index & (EVENT_CAPACITY - 1)] = {name, start, end};
+  track->written.store(index + 1, std::memory_order_release);
+}
+
+void record(const char *name, uint64_t start, uint64_t end) {
+  record(&thread_track(), name, start, end);
+}
+
+void set_thread_name(const char *name) {
+  thread_track().name.store(name, std::memory_order_relaxed);
+}
+
+/* Zone names are literals from our own code, only quotes and backslashes
+ * need escaping */
+static void write_string(std::ofstream &file, const char *string) {
+  file << '"';
+  for (const char *c = string; *c; ++c) {
+    if (*c == '"' || *c == '\\') {
+      file << '\\';
+    }
+    file << *c;
+  }
+  file << '"';
+}
+
+/* Copies the events still held by `track`, oldest first. The owner may
+ * keep recording meanwhile, so slots it overwrote during the copy are
+ * dropped afterwards */
+static std::vector<Event> snapshot(const Track &track) {
+  const uint64_t written = track.written.load(std::memory_order_acquire);
+  uint64_t first = written > EVENT_CAPACITY ? written - EVENT_CAPACITY : 0;
+
+  std::vector<Event> events;
+  events.reserve(written - first);
+  for (uint64_t i = first; i < written; ++i) {
+    events.push_back(track.events[i & (EVENT_CAPACITY - 1)]);
+  }
+
+  /* The event after the last published one may be half written too */
+  const uint64_t after = track.written.load(std::memory_order_acquire);
+  if (after + 1 > first + EVENT_CAPACITY) {
+    const uint64_t torn =
+        std::min<uint64_t>(after + 1 - EVENT_CAPACITY - first, events.size());
+    events.erase(events.begin(), events.begin() + torn);
+  }
+  return events;
+}
+
+bool write_trace(const char *path) {
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    LOG_ERROR("Failed to open trace file: {}", path);
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  size_t count = 0;
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  file.precision(3);
+  file << std::fixed;
+  for (const std::unique_ptr<Track> &track : registry) {
+    if (const char *name = track->name.load(std::memory_order_relaxed)) {
+      file << (count++ ? ",\n" : "\n")
+           << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":"
+           << track->id << ",\"args\":{\"name\":";
+      write_string(file, name);
+      file << "}}";
+    }
+
+    /* Timestamps and durations are in microseconds */
+    for (const Event &event : snapshot(*track)) {
+      file << (count++ ? ",\n" : "\n") << "{\"ph\":\"X\",\"name\":";
+      write_string(file, event.name);
+      file << ",\"pid\":1,\"tid\":" << track->id
+           << ",\"ts\":" << event.start / 1000.0
+           << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+    }
+  }
+  file << "\n]}\n";
+
+  LOG_INFO("Wrote {} trace events to {}", count, path);
+  return file.good();
+}
+
+} // namespace Profiler
+
+#endif /* BREAKOUT_PROFILER */
@@ -1,23 +1,66 @@
 #include <glad/glad.h>
+#define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
 #include <memory>
+#include <thread>
+#include <vector>
 
+#include "breakout/block_compression.hpp"
 #include "breakout/memory.hpp"
 #include "breakout/resource_manager.hpp"
+#include "breakout/resource_pack.hpp"
 #include "breakout/log.hpp"
 #include "breakout/shader.hpp"
 #include "breakout/texture2d.hpp"
 
-void ResourceManager::load_resources_impl() {
-  /* TODO: Use json format to load all necessary data */
+using Clock = std::chrono::steady_clock;
 
-  struct TextureInfo {
-    const char *name;
-    const char *filename;
-    bool alpha;
-  };
+static const char *CACHE_DIR = ".cache";
+static const char *TEXTURE_CACHE_PATH = ".cache/textures.bin";
+
+thread_local ResourceManager *ResourceManager::m_current = nullptr;
+
+static double elapsed_ms(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+/* Compressed textures are produced offline by `texcompress`, e.g.
+ * res/textures/face.png -> res/textures/compressed/face.dds */
+static std::string compressed_path(const char *path) {
+  std::string result(path);
+  const size_t slash = result.rfind('/');
+  const size_t dot = result.rfind('.');
+  const size_t stem = slash == std::string::npos ? 0 : slash + 1;
+  const size_t stem_end =
+      dot == std::string::npos || dot < stem ? result.size() : dot;
+  return result.substr(0, stem) + "compressed/" +
+         result.substr(stem, stem_end - stem) + ".dds";
+}
+
+static bool has_s3tc_support() {
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (GLint i = 0; i < count; ++i) {
+    const char *name =
+        reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+    if (name && !std::strcmp(name, "GL_EXT_texture_compression_s3tc")) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ResourceManager::register_resources_impl() {
+  /* TODO: Use json format to load all necessary data */
 
+  /* The alpha flags decide the block format compress_textures encodes in,
+   * see src/CMakeLists.txt */
   std::vector<TextureInfo> texture_infos = {
       {"background", "res/textures/background.jpg", false},
       {"face", "res/textures/awesomeface.png", true},
@@ -33,9 +76,15 @@ void ResourceManager::load_resources_impl() {
       {"powerup_passthrough", "res/textures/powerup_passthrough.png", true},
   };
 
-  for (TextureInfo &tinfo : texture_infos) {
-    ResourceManager::load_texture(tinfo.name, tinfo.filename, tinfo.alpha);
-  }
+  /* Textures are loaded by level, see BreakoutGame::prefetch_level */
+  register_textures_impl(texture_infos);
+}
+
+void ResourceManager::load_resources_impl() {
+  Memory::create_directory(CACHE_DIR);
+  m_texture_cache.open(TEXTURE_CACHE_PATH);
+
+  register_resources_impl();
 
   struct ShaderInfo {
     const char *name;
@@ -53,20 +102,214 @@ void ResourceManager::load_resources_impl() {
        "res/shaders/frag/post_processing.glsl"},
   };
 
+  const Clock::time_point shaders_start = Clock::now();
   for (ShaderInfo &sinfo : shader_infos) {
     ResourceManager::load_shader(sinfo.name, sinfo.vert_path, sinfo.frag_path,
                                  sinfo.geom_path);
   }
+  LOG_INFO("Built {} shaders in {:.2f} ms", shader_infos.size(),
+           elapsed_ms(shaders_start));
+}
+
+void ResourceManager::load_textures_impl(
+    const std::vector<TextureInfo> &infos) {
+  if (infos.empty()) {
+    return;
+  }
+
+  struct DecodedImage {
+    int width = 0, height = 0, channels = 0;
+    const unsigned char *pixels = nullptr;
+    /* Pixels point into the mapped texture cache */
+    bool cached = false;
+    uint64_t key = 0;
+    /* Block-compressed data, mapped from the pack or `compressed_file` */
+    bool is_compressed = false;
+    std::unique_ptr<Memory::MappedFile> compressed_file;
+    BlockCompression::Image compressed;
+    size_t size() const {
+      return is_compressed ? compressed.size
+                           : static_cast<size_t>(width) * height * channels;
+    }
+  };
+
+  std::vector<DecodedImage> images(infos.size());
+  const bool s3tc_supported = has_s3tc_support();
+  /* Backs files that can't be mapped until the uploads are done */
+  Memory::Arena file_arena;
+
+  /* Decode on a pool of workers, the main thread takes part as well */
+  const Clock::time_point decode_start = Clock::now();
+  std::atomic<size_t> next_image(0);
+  std::atomic<size_t> cache_hits(0);
+  auto decode = [&]() {
+    for (size_t i = next_image++; i < infos.size(); i = next_image++) {
+      DecodedImage &image = images[i];
+      image.channels = infos[i].alpha ? 4 : 3;
+
+      if (s3tc_supported) {
+        std::unique_ptr<Memory::MappedFile> file(new Memory::MappedFile);
+        const Memory::FileView dds = ResourcePack::open(
+            compressed_path(infos[i].filename).c_str(), *file, &file_arena);
+        if (!dds.empty() &&
+            BlockCompression::parse_dds(dds.data, dds.size, image.compressed)) {
+          image.width = image.compressed.width;
+          image.height = image.compressed.height;
+          image.pixels = image.compressed.data;
+          image.is_compressed = true;
+          image.compressed_file = std::move(file);
+          continue;
+        }
+      }
+
+      Memory::MappedFile file;
+      const Memory::FileView source =
+          ResourcePack::open(infos[i].filename, file, &file_arena);
+      if (source.empty()) {
+        continue;
+      }
+
+      image.key =
+          TextureCache::make_key(source.data, source.size, image.channels);
+      const TextureCache::Entry *entry = m_texture_cache.find(image.key);
+      if (entry && entry->size == static_cast<size_t>(entry->width) *
+                                      entry->height * image.channels) {
+        image.width = entry->width;
+        image.height = entry->height;
+        image.pixels = entry->texels;
+        image.cached = true;
+        ++cache_hits;
+        continue;
+      }
+
+      image.pixels = stbi_load_from_memory(
+          source.data, static_cast<int>(source.size), &image.width,
+          &image.height, nullptr, image.channels);
+    }
+  };
+
+  if (!m_decode_pool) {
+    m_decode_pool.reset(new WorkerPool(
+        std::max(std::thread::hardware_concurrency(), 2u) - 1));
+  }
+  const size_t num_workers =
+      std::min(m_decode_pool->size() + 1, infos.size());
+  for (size_t i = 1; i < num_workers; ++i) {
+    m_decode_pool->submit(decode);
+  }
+  decode();
+  m_decode_pool->wait();
+  const double decode_time = elapsed_ms(decode_start);
+
+  /* Stage all texels in one pixel buffer so that the uploads are
+   * asynchronous DMA transfers rather than synchronous copies */
+  const Clock::time_point upload_start = Clock::now();
+  std::vector<size_t> offsets(images.size());
+  size_t total_size = 0;
+  for (size_t i = 0; i < images.size(); ++i) {
+    offsets[i] = total_size;
+    total_size += images[i].size();
+  }
+
+  GLuint pbo;
+  glGenBuffers(1, &pbo);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, total_size, nullptr, GL_STREAM_DRAW);
+
+  unsigned char *staging = static_cast<unsigned char *>(
+      glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, total_size,
+                       GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+  for (size_t i = 0; i < images.size(); ++i) {
+    if (staging && images[i].pixels) {
+      std::memcpy(staging + offsets[i], images[i].pixels, images[i].size());
+    }
+  }
+  const bool staged = staging && glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+  if (!staged) {
+    LOG_WARN("Failed to stage textures in a pixel buffer");
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
+
+  /* Rows of RGB images are not necessarily 4 byte aligned */
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for (size_t i = 0; i < infos.size(); ++i) {
+    const TextureInfo &tinfo = infos[i];
+    DecodedImage &image = images[i];
+
+    Texture2D texture;
+    if (tinfo.alpha) {
+      texture.set_internal_format(GL_RGBA);
+      texture.set_image_format(GL_RGBA);
+    }
+    texture.set_mipmaps(tinfo.mipmaps);
+
+    if (!image.pixels) {
+      LOG_ERROR("Failed to load texture at path: {}", tinfo.filename);
+    } else if (image.is_compressed && staged) {
+      texture.generate_compressed_from_buffer(image.compressed, offsets[i]);
+    } else if (image.is_compressed) {
+      texture.generate_compressed(image.compressed);
+    } else if (staged) {
+      texture.generate_from_buffer(image.width, image.height, offsets[i]);
+    } else {
+      texture.generate(image.width, image.height, image.pixels);
+    }
+
+    LOG_INFO("Texture `{}`: {}x{}, {} levels, {}, {:.1f} KiB", tinfo.name,
+             texture.width(), texture.height(), texture.levels(),
+             image.is_compressed ? "block-compressed" : "uncompressed",
+             texture.memory_usage() / 1024.0);
+    set_texture(register_texture(tinfo).index, std::move(texture));
+
+    if (image.is_compressed) {
+      continue;
+    } else if (image.cached) {
+      m_texture_cache.retain(image.key);
+    } else if (image.pixels) {
+      m_texture_cache.store(image.key, {static_cast<uint32_t>(image.width),
+                                        static_cast<uint32_t>(image.height),
+                                        static_cast<uint32_t>(image.channels),
+                                        1, image.pixels, image.size()});
+      stbi_image_free(const_cast<unsigned char *>(image.pixels));
+    }
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  /* Deletion is deferred by the driver until the transfers are done */
+  glDeleteBuffers(1, &pbo);
+
+  LOG_INFO("Decoded {} textures ({} cached) in {:.2f} ms on {} threads, "
+           "uploaded in {:.2f} ms",
+           infos.size(), cache_hits.load(), decode_time, num_workers,
+           elapsed_ms(upload_start));
+
+  LOG_INFO("Texture memory usage: {:.1f} KiB",
+           texture_memory_usage_impl() / 1024.0);
 }
 
 std::shared_ptr<Shader>
 ResourceManager::load_shader_impl(const char *name, const char *vert_path,
                                   const char *frag_path,
                                   const char *geom_path) {
+  /* File views are NUL-terminated and compiled in place */
+  Memory::Arena arena;
+  Memory::MappedFile vert_file, frag_file, geom_file;
+  const Memory::FileView vert =
+      ResourcePack::open(vert_path, vert_file, &arena);
+  const Memory::FileView frag =
+      ResourcePack::open(frag_path, frag_file, &arena);
+  Memory::FileView geom;
+  if (geom_path) {
+    geom = ResourcePack::open(geom_path, geom_file, &arena);
+  }
+  if (vert.empty() || frag.empty() || (geom_path && geom.empty())) {
+    LOG_ERROR("Failed to read sources of shader `{}`", name);
+  }
+
+  m_shader_sources[name] = {vert_path, frag_path, geom_path ? geom_path : ""};
   return m_shaders[name] = std::make_shared<Shader>(
-             Memory::read_file(vert_path).c_str(),
-             Memory::read_file(frag_path).c_str(),
-             geom_path ? Memory::read_file(geom_path).c_str() : nullptr);
+             vert.text(), frag.text(), geom_path ? geom.text() : nullptr);
 }
 
 std::shared_ptr<Shader> ResourceManager::shader_impl(const char *name) {
@@ -78,42 +321,263 @@ std::shared_ptr<Shader> ResourceManager::shader_impl(const char *name) {
   return nullptr;
 }
 
-std::shared_ptr<Texture2D> ResourceManager::load_texture_impl(const char *name,
-                                                              const char *path,
-                                                              bool alpha) {
-  return m_textures[name] = load_texture_from_file(path, alpha);
+TextureHandle ResourceManager::load_texture_impl(const char *name,
+                                                const char *path, bool alpha) {
+  const TextureHandle handle = register_texture({name, path, alpha, false});
+  set_texture(handle.index, load_texture_from_file(path, alpha));
+  return handle;
 }
 
-std::shared_ptr<Texture2D> ResourceManager::texture_impl(const char *name) {
-  auto it = m_textures.find(name);
-  if (it != m_textures.end()) {
+TextureHandle ResourceManager::texture_handle_impl(const char *name) const {
+  auto it = m_texture_names.find(name);
+  if (it != m_texture_names.end()) {
     return it->second;
   }
   LOG_ERROR("Texture with name `{}` doesn't exist", name);
-  return nullptr;
+  return TextureHandle();
+}
+
+Texture2D *ResourceManager::texture_impl(TextureHandle handle) {
+  if (handle.index >= m_textures.size() ||
+      m_texture_generations[handle.index] != handle.generation) {
+    return nullptr;
+  }
+  if (!m_texture_resident[handle.index]) {
+    LOG_INFO("Loading texture `{}` on first use",
+             m_texture_sources[handle.index].name);
+    prefetch_textures_impl({handle});
+  }
+  m_texture_last_used[handle.index] = m_frame;
+  m_texture_pinned[handle.index] = false;
+  return &m_textures[handle.index];
+}
+
+void ResourceManager::register_textures_impl(
+    const std::vector<TextureInfo> &infos) {
+  for (const TextureInfo &info : infos) {
+    register_texture(info);
+  }
+}
+
+TextureHandle ResourceManager::register_texture(const TextureInfo &info) {
+  auto it = m_texture_names.find(info.name);
+  if (it != m_texture_names.end()) {
+    m_texture_sources[it->second.index] = {info.name, info.filename,
+                                           info.alpha, info.mipmaps};
+    return it->second;
+  }
+
+  TextureHandle handle;
+  handle.index = static_cast<uint16_t>(m_textures.size());
+  m_textures.emplace_back();
+  m_texture_sources.push_back(
+      {info.name, info.filename, info.alpha, info.mipmaps});
+  m_texture_resident.push_back(false);
+  m_texture_last_used.push_back(m_frame);
+  m_texture_pinned.push_back(false);
+  if (handle.index == m_texture_generations.size()) {
+    m_texture_generations.push_back(1);
+  }
+  handle.generation = m_texture_generations[handle.index];
+  return m_texture_names[info.name] = handle;
+}
+
+void ResourceManager::prefetch_textures_impl(
+    const std::vector<TextureHandle> &handles) {
+  std::vector<TextureInfo> infos;
+  for (TextureHandle handle : handles) {
+    if (handle.index >= m_textures.size() ||
+        m_texture_generations[handle.index] != handle.generation) {
+      continue;
+    }
+    m_texture_pinned[handle.index] = true;
+    if (!m_texture_resident[handle.index]) {
+      const TextureSource &source = m_texture_sources[handle.index];
+      infos.push_back({source.name.c_str(), source.filename.c_str(),
+                       source.alpha, source.mipmaps});
+    }
+  }
+  if (!infos.empty()) {
+    load_textures_impl(infos);
+  }
+}
+
+void ResourceManager::unpin_textures_impl() {
+  std::fill(m_texture_pinned.begin(), m_texture_pinned.end(), false);
+}
+
+/* Replaces the texture in place, handles to it stay valid */
+void ResourceManager::set_texture(uint16_t index, Texture2D &&texture) {
+  m_texture_memory -= m_textures[index].memory_usage();
+  m_texture_memory += texture.memory_usage();
+  m_textures[index] = std::move(texture);
+  m_texture_resident[index] = true;
+  m_texture_last_used[index] = m_frame;
+}
+
+/* The slot keeps its generation, so the texture is transparently loaded
+ * again the next time it's used */
+void ResourceManager::evict_texture(uint16_t index) {
+  LOG_INFO("Evicting texture `{}`, {:.1f} KiB", m_texture_sources[index].name,
+           m_textures[index].memory_usage() / 1024.0);
+  m_texture_memory -= m_textures[index].memory_usage();
+  m_textures[index] = Texture2D();
+  m_texture_resident[index] = false;
+}
+
+void ResourceManager::end_frame_impl() {
+  const uint64_t frame = m_frame++;
+  /* Textures loaded during the frame don't rewrite the cache file under it */
+  if (m_texture_cache.is_dirty()) {
+    m_texture_cache.save();
+  }
+  if (!m_texture_budget || m_texture_memory <= m_texture_budget ||
+      frame < TEXTURE_EVICTION_AGE) {
+    return;
+  }
+
+  /* Reused, a working set over budget is evicted from on every frame */
+  std::vector<uint16_t> &candidates = m_eviction_candidates;
+  candidates.clear();
+  for (size_t i = 0; i < m_textures.size(); ++i) {
+    if (m_texture_resident[i] && !m_texture_pinned[i] &&
+        m_texture_last_used[i] <= frame - TEXTURE_EVICTION_AGE) {
+      candidates.push_back(static_cast<uint16_t>(i));
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [this](uint16_t a, uint16_t b) {
+              return m_texture_last_used[a] < m_texture_last_used[b];
+            });
+
+  for (uint16_t index : candidates) {
+    if (m_texture_memory <= m_texture_budget) {
+      break;
+    }
+    evict_texture(index);
+  }
+}
+
+size_t ResourceManager::texture_memory_usage_impl() const {
+  return m_texture_memory;
+}
+
+void ResourceManager::watch_resources_impl() {
+  /* Changes to loose files wouldn't be seen through the pack */
+  if (ResourcePack::is_mounted()) {
+    LOG_INFO("Resource pack is mounted, hot reloading is disabled");
+    return;
+  }
+
+  const char *directories[] = {
+      "res/shaders/vert",    "res/shaders/frag", "res/textures",
+      "res/textures/compressed", "res/levels",
+  };
+  for (const char *directory : directories) {
+    m_watcher.watch(directory);
+  }
+}
+
+bool ResourceManager::poll_hot_reload_impl(std::vector<std::string> &changed) {
+  bool reloaded = false;
+
+  m_changed_files.clear();
+  m_watcher.poll(m_changed_files);
+  for (const std::string &path : m_changed_files) {
+    bool handled = false;
+
+    for (const auto &sources : m_shader_sources) {
+      const ShaderSources &src = sources.second;
+      if (path != src.vertex && path != src.fragment && path != src.geometry) {
+        continue;
+      }
+
+      Memory::MappedFile vert_file, frag_file, geom_file;
+      const Memory::FileView vert =
+          ResourcePack::open(src.vertex.c_str(), vert_file);
+      const Memory::FileView frag =
+          ResourcePack::open(src.fragment.c_str(), frag_file);
+      Memory::FileView geom;
+      if (!src.geometry.empty()) {
+        geom = ResourcePack::open(src.geometry.c_str(), geom_file);
+      }
+
+      LOG_INFO("Rebuilding shader `{}`", sources.first);
+      m_shaders[sources.first]->rebuild(
+          vert.text(), frag.text(),
+          src.geometry.empty() ? nullptr : geom.text());
+      handled = true;
+    }
+
+    for (size_t i = 0; i < m_texture_sources.size(); ++i) {
+      const TextureSource &source = m_texture_sources[i];
+      const char *filename = source.filename.c_str();
+      if (path != filename && path != compressed_path(filename)) {
+        continue;
+      }
+
+      /* Textures that aren't resident will be loaded fresh anyway */
+      handled = true;
+      if (m_texture_resident[i]) {
+        LOG_INFO("Reloading texture `{}`", source.name);
+        load_textures_impl(
+            {{source.name.c_str(), filename, source.alpha, source.mipmaps}});
+        reloaded = true;
+      }
+    }
+
+    if (!handled) {
+      changed.push_back(path);
+    }
+  }
+
+  for (auto &shader : m_shaders) {
+    if (shader.second->is_rebuilding() && shader.second->poll_rebuild()) {
+      LOG_INFO("Swapped in rebuilt shader `{}`", shader.first);
+      reloaded = true;
+    }
+  }
+  return reloaded;
 }
 
 void ResourceManager::clear_impl() {
+  if (m_texture_cache.is_dirty()) {
+    m_texture_cache.save();
+  }
   m_shaders.clear();
+  m_shader_sources.clear();
   m_textures.clear();
+  m_texture_sources.clear();
+  m_texture_resident.clear();
+  m_texture_last_used.clear();
+  m_texture_pinned.clear();
+  m_texture_names.clear();
+  m_texture_memory = 0;
+  /* Invalidate all handles issued so far, 0 is never a valid generation */
+  for (uint16_t &generation : m_texture_generations) {
+    generation = generation == UINT16_MAX ? 1 : generation + 1;
+  }
 }
 
-std::shared_ptr<Texture2D>
-ResourceManager::load_texture_from_file(const char *path, bool alpha) {
-  std::shared_ptr<Texture2D> texture = std::make_shared<Texture2D>();
+Texture2D ResourceManager::load_texture_from_file(const char *path,
+                                                  bool alpha) {
+  Texture2D texture;
   if (alpha) {
-    texture->set_internal_format(GL_RGBA);
-    texture->set_image_format(GL_RGBA);
+    texture.set_internal_format(GL_RGBA);
+    texture.set_image_format(GL_RGBA);
   }
 
-  int width, height, nrChannels;
-  unsigned char *data = stbi_load(path, &width, &height, &nrChannels, 0);
+  int width, height;
+  unsigned char *data =
+      stbi_load(path, &width, &height, nullptr, alpha ? 4 : 3);
   if (!data) {
     LOG_ERROR("Failed to load texture at path: {}", path);
     return texture;
   }
 
-  texture->generate(width, height, data);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  texture.generate(width, height, data);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
   stbi_image_free(data);
   return texture;
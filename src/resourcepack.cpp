@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <cstring>
+
+#include "breakout/hash.hpp"
+#include "breakout/log.hpp"
+#include "breakout/resource_pack.hpp"
+
+constexpr char ResourcePack::MAGIC[4];
+constexpr uint32_t ResourcePack::VERSION;
+constexpr size_t ResourcePack::DATA_ALIGNMENT;
+
+bool ResourcePack::mount_impl(const char *path) {
+  unmount_impl();
+
+  if (!m_file.open(path)) {
+    return false;
+  }
+
+  const unsigned char *data = m_file.data();
+  const size_t size = m_file.size();
+
+  Header header;
+  if (size < sizeof(header)) {
+    LOG_ERROR("Invalid resource pack: {}", path);
+    unmount_impl();
+    return false;
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) ||
+      header.version != VERSION ||
+      header.count > (size - sizeof(header)) / sizeof(Record)) {
+    LOG_ERROR("Invalid resource pack: {}", path);
+    unmount_impl();
+    return false;
+  }
+
+  m_hashes.reserve(header.count);
+  m_entries.reserve(header.count);
+  for (uint32_t i = 0; i < header.count; ++i) {
+    Record record;
+    std::memcpy(&record, data + sizeof(header) + i * sizeof(record),
+                sizeof(record));
+
+    /* Data is followed by a NUL byte, paths are NUL-terminated */
+    if (record.path_offset >= size || record.data_offset > size ||
+        record.data_size >= size - record.data_offset ||
+        !std::memchr(data + record.path_offset, '\0',
+                     size - record.path_offset)) {
+      LOG_ERROR("Corrupted resource pack: {}", path);
+      unmount_impl();
+      return false;
+    }
+
+    m_hashes.push_back(record.path_hash);
+    m_entries.push_back(
+        {reinterpret_cast<const char *>(data + record.path_offset),
+         data + record.data_offset, static_cast<size_t>(record.data_size)});
+  }
+
+  LOG_INFO("Mounted resource pack `{}` with {} entries", path, header.count);
+  return true;
+}
+
+void ResourcePack::unmount_impl() {
+  m_hashes.clear();
+  m_entries.clear();
+  m_file.close();
+}
+
+const ResourcePack::Entry *ResourcePack::find_impl(const char *path) const {
+  if (m_entries.empty()) {
+    return nullptr;
+  }
+
+  const uint64_t hash = Hash::fnv1a(path, std::strlen(path));
+  auto it = std::lower_bound(m_hashes.begin(), m_hashes.end(), hash);
+  for (; it != m_hashes.end() && *it == hash; ++it) {
+    const Entry &entry = m_entries[it - m_hashes.begin()];
+    if (!std::strcmp(entry.path, path)) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+Memory::FileView ResourcePack::open(const char *path, Memory::MappedFile &file,
+                                    Memory::Arena *arena) {
+  if (const Entry *entry = find(path)) {
+    Memory::FileView view;
+    view.data = entry->data;
+    view.size = entry->size;
+    return view;
+  }
+  if (!file.open(path, arena)) {
+    return Memory::FileView();
+  }
+  return file.view();
+}
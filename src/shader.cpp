@@ -1,15 +1,245 @@
 #include <glad/glad.h>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "breakout/hash.hpp"
+#include "breakout/memory.hpp"
 #include "breakout/shader.hpp"
 #include "breakout/log.hpp"
 
+/* From KHR_parallel_shader_compile, which glad doesn't load */
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+
+static const char *CACHE_DIR = ".cache";
+static const char *SHADER_CACHE_DIR = ".cache/shaders";
+
+static uint64_t hash_string(const char *str, uint64_t seed) {
+  /* Hash the terminator too so that ("ab", "c") != ("a", "bc") */
+  return str ? Hash::fnv1a(str, std::strlen(str) + 1, seed)
+             : Hash::fnv1a("", 1, seed);
+}
+
+/* Binaries are only valid for the driver that produced them */
+static uint64_t program_key(const char *vertex_src, const char *fragment_src,
+                            const char *geometry_src) {
+  uint64_t key = Hash::FNV_OFFSET_BASIS;
+  key = hash_string(vertex_src, key);
+  key = hash_string(fragment_src, key);
+  key = hash_string(geometry_src, key);
+  for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+    key = hash_string(reinterpret_cast<const char *>(glGetString(name)), key);
+  }
+  return key;
+}
+
+static std::string program_cache_path(uint64_t key) {
+  char path[64];
+  std::snprintf(path, sizeof(path), "%s/%016llx.bin", SHADER_CACHE_DIR,
+                static_cast<unsigned long long>(key));
+  return path;
+}
+
+static bool binary_cache_supported() {
+  GLint num_formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+  return num_formats > 0;
+}
+
+static bool load_program_binary(GLuint program, uint64_t key) {
+  Memory::MappedFile file;
+  GLenum format;
+  if (!file.open(program_cache_path(key).c_str()) ||
+      file.size() <= sizeof(format)) {
+    return false;
+  }
+  std::memcpy(&format, file.data(), sizeof(format));
+
+  glProgramBinary(program, format, file.data() + sizeof(format),
+                  static_cast<GLsizei>(file.size() - sizeof(format)));
+
+  /* Fails if the driver has changed in a way it doesn't accept */
+  GLint success;
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  return success == GL_TRUE;
+}
+
+static void save_program_binary(GLuint program, uint64_t key) {
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+
+  GLenum format;
+  std::vector<char> binary(length);
+  glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+  Memory::create_directory(CACHE_DIR);
+  Memory::create_directory(SHADER_CACHE_DIR);
+
+  const std::string path = program_cache_path(key);
+  std::ofstream file(path, std::ios::binary);
+  file.write(reinterpret_cast<const char *>(&format), sizeof(format));
+  file.write(binary.data(), binary.size());
+  if (!file) {
+    LOG_WARN("Failed to write shader cache: {}", path);
+  }
+}
+
+static bool has_extension(const char *extension) {
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (GLint i = 0; i < count; ++i) {
+    const char *name =
+        reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+    if (name && !std::strcmp(name, extension)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Lets us ask whether a link has finished without waiting for it */
+static bool parallel_compile_supported() {
+  static const bool supported =
+      has_extension("GL_KHR_parallel_shader_compile") ||
+      has_extension("GL_ARB_parallel_shader_compile");
+  return supported;
+}
+
+static void log_shader_error(GLuint shader) {
+  GLint success;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+  if (!success) {
+    GLchar info_log[1024];
+    glGetShaderInfoLog(shader, 1024, NULL, info_log);
+    LOG_ERROR(info_log);
+  }
+}
+
+/* Active uniforms of `program` by name. Array uniforms are reported once,
+ * as "name[0]" */
+static std::unordered_map<std::string, std::pair<GLenum, GLint>>
+active_uniforms(GLuint program) {
+  std::unordered_map<std::string, std::pair<GLenum, GLint>> uniforms;
+  GLint count = 0;
+  glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+  for (GLint i = 0; i < count; ++i) {
+    GLchar name[256];
+    GLint size;
+    GLenum type;
+    glGetActiveUniform(program, i, sizeof(name), nullptr, &size, &type, name);
+    uniforms[name] = std::make_pair(type, size);
+  }
+  return uniforms;
+}
+
+static void copy_uniform(GLuint from, GLint from_location, GLuint to,
+                         GLint to_location, GLenum type) {
+  GLfloat f[16];
+  GLint i[4];
+  switch (type) {
+  case GL_FLOAT:
+    glGetUniformfv(from, from_location, f);
+    glProgramUniform1fv(to, to_location, 1, f);
+    break;
+  case GL_FLOAT_VEC2:
+    glGetUniformfv(from, from_location, f);
+    glProgramUniform2fv(to, to_location, 1, f);
+    break;
+  case GL_FLOAT_VEC3:
+    glGetUniformfv(from, from_location, f);
+    glProgramUniform3fv(to, to_location, 1, f);
+    break;
+  case GL_FLOAT_VEC4:
+    glGetUniformfv(from, from_location, f);
+    glProgramUniform4fv(to, to_location, 1, f);
+    break;
+  case GL_FLOAT_MAT2:
+    glGetUniformfv(from, from_location, f);
+    glProgramUniformMatrix2fv(to, to_location, 1, GL_FALSE, f);
+    break;
+  case GL_FLOAT_MAT3:
+    glGetUniformfv(from, from_location, f);
+    glProgramUniformMatrix3fv(to, to_location, 1, GL_FALSE, f);
+    break;
+  case GL_FLOAT_MAT4:
+    glGetUniformfv(from, from_location, f);
+    glProgramUniformMatrix4fv(to, to_location, 1, GL_FALSE, f);
+    break;
+  case GL_INT_VEC2:
+  case GL_BOOL_VEC2:
+    glGetUniformiv(from, from_location, i);
+    glProgramUniform2iv(to, to_location, 1, i);
+    break;
+  case GL_INT_VEC3:
+  case GL_BOOL_VEC3:
+    glGetUniformiv(from, from_location, i);
+    glProgramUniform3iv(to, to_location, 1, i);
+    break;
+  case GL_INT_VEC4:
+  case GL_BOOL_VEC4:
+    glGetUniformiv(from, from_location, i);
+    glProgramUniform4iv(to, to_location, 1, i);
+    break;
+  default:
+    /* int, bool and sampler uniforms */
+    glGetUniformiv(from, from_location, i);
+    glProgramUniform1iv(to, to_location, 1, i);
+    break;
+  }
+}
+
+/* Uniforms are set once at startup, so carry over every value that exists
+ * with the same type in both programs */
+static void copy_uniforms(GLuint from, GLuint to) {
+  const auto to_uniforms = active_uniforms(to);
+  for (const auto &uniform : active_uniforms(from)) {
+    auto it = to_uniforms.find(uniform.first);
+    if (it == to_uniforms.end() || it->second.first != uniform.second.first) {
+      continue;
+    }
+
+    const GLenum type = uniform.second.first;
+    const GLint size = std::min(uniform.second.second, it->second.second);
+    std::string name = uniform.first;
+    const size_t bracket = name.find('[');
+    if (bracket != std::string::npos) {
+      name.resize(bracket);
+    }
+
+    for (GLint element = 0; element < size; ++element) {
+      const std::string element_name =
+          size > 1 ? name + "[" + std::to_string(element) + "]" : name;
+      const GLint from_location =
+          glGetUniformLocation(from, element_name.c_str());
+      const GLint to_location = glGetUniformLocation(to, element_name.c_str());
+      if (from_location != -1 && to_location != -1) {
+        copy_uniform(from, from_location, to, to_location, type);
+      }
+    }
+  }
+}
+
 Shader::Shader(const char *vertex_src, const char *fragment_src,
                const char *geometry_src) {
   m_id = glCreateProgram();
 
+  const bool use_cache = binary_cache_supported();
+  const uint64_t key =
+      use_cache ? program_key(vertex_src, fragment_src, geometry_src) : 0;
+  if (use_cache && load_program_binary(m_id, key)) {
+    return;
+  }
+
   std::vector<GLuint> shaders{
       compile_shader(GL_VERTEX_SHADER, vertex_src),
       compile_shader(GL_FRAGMENT_SHADER, fragment_src),
@@ -22,6 +252,9 @@ Shader::Shader(const char *vertex_src, const char *fragment_src,
   for (GLuint shader : shaders) {
     glAttachShader(m_id, shader);
   }
+  if (use_cache) {
+    glProgramParameteri(m_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
   glLinkProgram(m_id);
 
   GLint success;
@@ -34,10 +267,16 @@ Shader::Shader(const char *vertex_src, const char *fragment_src,
     m_id = 0;
 
     LOG_ERROR(info_log);
+  } else if (use_cache) {
+    save_program_binary(m_id, key);
   }
 
+#ifndef NDEBUG
   /* Check if current program can execute given the current OpenGL state */
-  glValidateProgram(m_id);
+  if (m_id) {
+    glValidateProgram(m_id);
+  }
+#endif /* NDEBUG */
 
   for (GLuint shader : shaders) {
     /* Before removing shaders we must detach them from the shader program,
@@ -50,23 +289,132 @@ Shader::Shader(const char *vertex_src, const char *fragment_src,
   }
 }
 
-Shader::~Shader() { glDeleteProgram(m_id); }
+Shader::~Shader() {
+  discard_rebuild();
+  glDeleteProgram(m_id);
+}
 
 Shader &Shader::operator=(Shader &&shader) {
+  discard_rebuild();
   glDeleteProgram(m_id);
   m_id = shader.m_id;
   m_location_cache = std::move(shader.m_location_cache);
+  m_pending_id = shader.m_pending_id;
+  m_pending_shaders = std::move(shader.m_pending_shaders);
+  m_pending_key = shader.m_pending_key;
+  m_pending_polls = shader.m_pending_polls;
 
   shader.m_id = 0;
+  shader.m_pending_id = 0;
   return *this;
 }
 
-Shader::Shader(Shader &&shader) {
+Shader::Shader(Shader &&shader)
+    : m_id(shader.m_id), m_location_cache(std::move(shader.m_location_cache)),
+      m_pending_id(shader.m_pending_id),
+      m_pending_shaders(std::move(shader.m_pending_shaders)),
+      m_pending_key(shader.m_pending_key),
+      m_pending_polls(shader.m_pending_polls) {
+  shader.m_id = 0;
+  shader.m_pending_id = 0;
+}
+
+void Shader::rebuild(const char *vertex_src, const char *fragment_src,
+                     const char *geometry_src) {
+  discard_rebuild();
+
+  m_pending_id = glCreateProgram();
+  m_pending_polls = 0;
+
+  const bool use_cache = binary_cache_supported();
+  m_pending_key =
+      use_cache ? program_key(vertex_src, fragment_src, geometry_src) : 0;
+  if (use_cache) {
+    glProgramParameteri(m_pending_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                        GL_TRUE);
+  }
+
+  /* Nothing here queries a status, which would wait for the compiler */
+  const GLenum types[] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER,
+                          GL_GEOMETRY_SHADER};
+  const char *sources[] = {vertex_src, fragment_src, geometry_src};
+  for (size_t i = 0; i < 3; ++i) {
+    if (!sources[i]) {
+      continue;
+    }
+    GLuint shader = glCreateShader(types[i]);
+    glShaderSource(shader, 1, &sources[i], NULL);
+    glCompileShader(shader);
+    glAttachShader(m_pending_id, shader);
+    m_pending_shaders.push_back(shader);
+  }
+  glLinkProgram(m_pending_id);
+}
+
+bool Shader::poll_rebuild() {
+  if (!m_pending_id) {
+    return false;
+  }
+
+  /* The link status is only available once the driver is done. Without
+   * parallel compile support there's no way to ask, so give the driver's own
+   * compiler thread a frame and then accept that reading the status below
+   * stalls this frame until the link has finished. Hot reload is a
+   * development feature, a hitch on such drivers doesn't warrant a second
+   * context */
+  if (parallel_compile_supported()) {
+    GLint completed = GL_FALSE;
+    glGetProgramiv(m_pending_id, GL_COMPLETION_STATUS_KHR, &completed);
+    if (!completed) {
+      return false;
+    }
+  } else if (m_pending_polls++ == 0) {
+    return false;
+  }
+
+  GLint success;
+  glGetProgramiv(m_pending_id, GL_LINK_STATUS, &success);
+  if (!success) {
+    for (GLuint shader : m_pending_shaders) {
+      log_shader_error(shader);
+    }
+    GLchar info_log[1024];
+    glGetProgramInfoLog(m_pending_id, 1024, NULL, info_log);
+    LOG_ERROR(info_log);
+    LOG_ERROR("Failed to rebuild shader program, keeping the previous one");
+    discard_rebuild();
+    return false;
+  }
+
+  if (m_id) {
+    copy_uniforms(m_id, m_pending_id);
+  }
+  if (m_pending_key) {
+    save_program_binary(m_pending_id, m_pending_key);
+  }
+  for (GLuint shader : m_pending_shaders) {
+    glDetachShader(m_pending_id, shader);
+    glDeleteShader(shader);
+  }
+  m_pending_shaders.clear();
+
+  /* Deleting a program that is in use is deferred until it's unbound */
   glDeleteProgram(m_id);
-  m_id = shader.m_id;
-  m_location_cache = std::move(shader.m_location_cache);
+  m_id = m_pending_id;
+  m_pending_id = 0;
+  m_location_cache.clear();
+  return true;
+}
 
-  shader.m_id = 0;
+void Shader::discard_rebuild() {
+  for (GLuint shader : m_pending_shaders) {
+    glDeleteShader(shader);
+  }
+  m_pending_shaders.clear();
+  if (m_pending_id) {
+    glDeleteProgram(m_pending_id);
+    m_pending_id = 0;
+  }
 }
 
 GLuint Shader::compile_shader(GLuint shader_type, const char *source) const {
@@ -145,8 +493,10 @@ void Shader::setmat4f(const char *name, const glm::mat4 &mat) {
 GLuint Shader::id() const { return m_id; }
 
 GLint Shader::find_uniform(const char *name) {
-  if (m_location_cache.find(name) != m_location_cache.end()) {
-    return m_location_cache.at(name);
+  for (const CachedLocation &cached : m_location_cache) {
+    if (!std::strcmp(cached.name.c_str(), name)) {
+      return cached.location;
+    }
   }
   GLint unif_loc = glGetUniformLocation(m_id, name);
   if (unif_loc == -1) {
@@ -154,6 +504,6 @@ GLint Shader::find_uniform(const char *name) {
     return -1;
   }
 
-  m_location_cache[name] = unif_loc;
+  m_location_cache.push_back({name, unif_loc});
   return unif_loc;
 }
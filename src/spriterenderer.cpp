@@ -17,10 +17,9 @@ SpriteRenderer::~SpriteRenderer() {
   glDeleteVertexArrays(1, &m_quad_vao);
 }
 
-void SpriteRenderer::draw(Texture2D &texture, glm::vec2 position,
-                          glm::vec2 size, float rotate, glm::vec3 color) {
-  glm::mat4 model =
-      glm::translate(glm::mat4(1.0f), glm::vec3(position, 0.0f)) *
+glm::mat4 SpriteRenderer::model_matrix(glm::vec2 position, glm::vec2 size,
+                                       float rotate) {
+  return glm::translate(glm::mat4(1.0f), glm::vec3(position, 0.0f)) *
       glm::translate(glm::mat4(1.0f),
                      glm::vec3(0.5f * size.x, 0.5f * size.y, 0.0f)) *
       glm::rotate(glm::mat4(1.0f), glm::radians(rotate),
@@ -28,6 +27,11 @@ void SpriteRenderer::draw(Texture2D &texture, glm::vec2 position,
       glm::translate(glm::mat4(1.0f),
                      glm::vec3(-0.5f * size.x, -0.5f * size.y, 0.0f)) *
       glm::scale(glm::mat4(1.0f), glm::vec3(size, 1.0f));
+}
+
+void SpriteRenderer::draw(Texture2D &texture, glm::vec2 position,
+                          glm::vec2 size, float rotate, glm::vec3 color) {
+  const glm::mat4 model = model_matrix(position, size, rotate);
 
   m_shader->bind();
   m_shader->setmat4f("model", model);
@@ -39,6 +43,10 @@ void SpriteRenderer::draw(Texture2D &texture, glm::vec2 position,
   glBindVertexArray(m_quad_vao);
   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
   glBindVertexArray(0);
+
+  m_stats.draw_calls += 1;
+  m_stats.state_changes += 5;
+  m_stats.vertices += 4;
 }
 
 void SpriteRenderer::init_render_data() {
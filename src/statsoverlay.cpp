@@ -0,0 +1,74 @@
+#include <cstdio>
+
+#include "breakout/stats_overlay.hpp"
+#include "breakout/text_renderer.hpp"
+
+static const float LINE_HEIGHT = 18.0f;
+static const float TEXT_SCALE = 0.6f;
+static const glm::vec3 TEXT_COLOR = glm::vec3(1.0f, 1.0f, 0.0f);
+/* Enough for a window at a few hundred frames per second */
+static const size_t FRAME_SAMPLES = 256;
+
+StatsOverlay::StatsOverlay() { m_frame_times.reserve(FRAME_SAMPLES); }
+
+void StatsOverlay::set_visible(bool visible) {
+  m_visible = visible;
+  /* Start a fresh window rather than averaging over the hidden time */
+  m_frame_times.clear();
+  m_ticks = 0;
+  m_window_start = m_last_frame;
+}
+
+void StatsOverlay::add_frame(double time) {
+  if (m_visible && m_last_frame >= 0.0) {
+    m_frame_times.add((time - m_last_frame) * 1000.0);
+  }
+  m_last_frame = time;
+
+  if (m_window_start < 0.0) {
+    m_window_start = time;
+  }
+  const double elapsed = time - m_window_start;
+  if (elapsed < REFRESH_INTERVAL) {
+    return;
+  }
+
+  m_frame_average = m_frame_times.average();
+  m_frame_p99 = m_frame_times.percentile(99.0);
+  m_tick_rate = m_ticks / elapsed;
+  m_frame_times.clear();
+  m_ticks = 0;
+  m_window_start = time;
+}
+
+void StatsOverlay::draw(TextRenderer &renderer, const Counters &counters,
+                        float x, float y) const {
+  char line[96];
+
+  std::snprintf(line, sizeof(line), "frame %.2f ms avg, %.2f ms p99",
+                m_frame_average, m_frame_p99);
+  renderer.render(line, x, y, TEXT_SCALE, TEXT_COLOR);
+
+  std::snprintf(line, sizeof(line), "ticks %.0f/s", m_tick_rate);
+  renderer.render(line, x, y - LINE_HEIGHT, TEXT_SCALE, TEXT_COLOR);
+
+  std::snprintf(line, sizeof(line), "draws %u, state changes %u, vertices %u",
+                counters.render.draw_calls, counters.render.state_changes,
+                counters.render.vertices);
+  renderer.render(line, x, y - 2.0f * LINE_HEIGHT, TEXT_SCALE, TEXT_COLOR);
+
+  std::snprintf(line, sizeof(line), "particles %zu, power-ups %zu, bricks %zu",
+                counters.particles, counters.powerups, counters.bricks);
+  renderer.render(line, x, y - 3.0f * LINE_HEIGHT, TEXT_SCALE, TEXT_COLOR);
+
+  std::snprintf(line, sizeof(line), "texture memory %.1f MiB",
+                counters.texture_memory / (1024.0 * 1024.0));
+  renderer.render(line, x, y - 4.0f * LINE_HEIGHT, TEXT_SCALE, TEXT_COLOR);
+
+  std::snprintf(line, sizeof(line), "allocations input %llu, update %llu, "
+                "render %llu",
+                static_cast<unsigned long long>(counters.input_allocations),
+                static_cast<unsigned long long>(counters.update_allocations),
+                static_cast<unsigned long long>(counters.render_allocations));
+  renderer.render(line, x, y - 5.0f * LINE_HEIGHT, TEXT_SCALE, TEXT_COLOR);
+}
@@ -2,14 +2,17 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <ft2build.h>
+#include <cstring>
 #include <utility>
 #include FT_FREETYPE_H
 
 #include "breakout/text_renderer.hpp"
 #include "breakout/shader.hpp"
 #include "breakout/log.hpp"
+#include "breakout/memory.hpp"
 
 #include "breakout/resource_manager.hpp"
+#include "breakout/resource_pack.hpp"
 
 TextRenderer::TextRenderer(uint32_t width, uint32_t height) {
   m_shader = ResourceManager::load_shader(
@@ -48,9 +51,15 @@ void TextRenderer::load(const char *path, uint32_t font_size) {
     return;
   }
 
+  /* FreeType reads the face lazily, so the view must outlive it */
+  Memory::MappedFile file;
+  const Memory::FileView view = ResourcePack::open(path, file);
   FT_Face face;
-  if (FT_New_Face(ft, path, 0, &face)) {
+  if (view.empty() ||
+      FT_New_Memory_Face(ft, view.data, static_cast<FT_Long>(view.size), 0,
+                         &face)) {
     LOG_ERROR("Failed to load font at path: {}", path);
+    FT_Done_FreeType(ft);
     return;
   }
 
@@ -86,6 +95,22 @@ void TextRenderer::load(const char *path, uint32_t font_size) {
   FT_Done_FreeType(ft);
 }
 
+void TextRenderer::glyph_quad(const TextCharacter &ch, float x, float y,
+                              float scale, float vertices[4][4]) {
+  const float xpos = x + ch.bearing.x * scale;
+  const float ypos = y - (ch.size.y - ch.bearing.y) * scale;
+
+  const float w = ch.size.x * scale;
+  const float h = ch.size.y * scale;
+  const float quad[4][4] = {
+      {xpos, ypos + h, 0.0f, 0.0f},     //
+      {xpos + w, ypos + h, 1.0f, 0.0f}, //
+      {xpos, ypos, 0.0f, 1.0f},         //
+      {xpos + w, ypos, 1.0f, 1.0f},     //
+  };
+  std::memcpy(vertices, quad, sizeof(quad));
+}
+
 void TextRenderer::render(const char *text, float x, float y, float scale,
                           glm::vec3 color) {
   m_shader->bind();
@@ -93,6 +118,7 @@ void TextRenderer::render(const char *text, float x, float y, float scale,
 
   glActiveTexture(GL_TEXTURE0);
   glBindVertexArray(m_vao);
+  m_stats.state_changes += 3;
 
   for (const char *c = text; *c; ++c) {
     auto it = m_characters.find(*c);
@@ -100,19 +126,9 @@ void TextRenderer::render(const char *text, float x, float y, float scale,
       LOG_WARN("Failed to render '{}` character", *c);
       continue;
     }
-    TextCharacter ch = it->second;
-
-    float xpos = x + ch.bearing.x * scale;
-    float ypos = y - (ch.size.y - ch.bearing.y) * scale;
-
-    float w = ch.size.x * scale;
-    float h = ch.size.y * scale;
-    float vertices[6][4] = {
-        {xpos, ypos + h, 0.0f, 0.0f},     //
-        {xpos + w, ypos + h, 1.0f, 0.0f}, //
-        {xpos, ypos, 0.0f, 1.0f},         //
-        {xpos + w, ypos, 1.0f, 1.0f},     //
-    };
+    const TextCharacter &ch = it->second;
+    float vertices[4][4];
+    glyph_quad(ch, x, y, scale, vertices);
 
     glBindTexture(GL_TEXTURE_2D, ch.texture_id);
 
@@ -121,10 +137,14 @@ void TextRenderer::render(const char *text, float x, float y, float scale,
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    m_stats.draw_calls += 1;
+    m_stats.state_changes += 3;
+    m_stats.vertices += 4;
 
     // bitshift by 6 to get value in pixels (2^6 = 64)
     x += (ch.advance >> 6) * scale;
   }
   glBindVertexArray(0);
   glBindTexture(GL_TEXTURE_2D, 0);
+  m_stats.state_changes += 2;
 }
@@ -1,58 +1,168 @@
 #include <glad/glad.h>
 
+#include <algorithm>
+
+#include "breakout/block_compression.hpp"
 #include "breakout/texture2d.hpp"
 
 Texture2D::Texture2D()
-    : m_width(0), m_height(0), m_internal_format(GL_RGB),
+    : m_id(0), m_width(0), m_height(0), m_levels(1), m_internal_format(GL_RGB),
       m_image_format(GL_RGB), m_wrap_s(GL_REPEAT), m_wrap_t(GL_REPEAT),
-      m_filter_min(GL_LINEAR), m_filter_max(GL_LINEAR) {
-  glGenTextures(1, &m_id);
-}
+      m_filter_min(GL_LINEAR), m_filter_max(GL_LINEAR), m_mipmaps(false),
+      m_memory_usage(0) {}
 
-Texture2D::~Texture2D() { glDeleteTextures(1, &m_id); }
+/* The GL name is only created once storage is allocated, so textures can be
+ * registered and evicted without a current context */
+Texture2D::~Texture2D() {
+  if (m_id != 0) {
+    glDeleteTextures(1, &m_id);
+  }
+}
 
 Texture2D &Texture2D::operator=(Texture2D &&texture) {
-  glDeleteTextures(1, &m_id);
+  if (m_id != 0) {
+    glDeleteTextures(1, &m_id);
+  }
 
   m_id = texture.m_id;
   m_width = texture.m_width;
   m_height = texture.m_height;
+  m_levels = texture.m_levels;
   m_filter_max = texture.m_filter_max;
   m_filter_min = texture.m_filter_min;
   m_wrap_s = texture.m_wrap_s;
   m_wrap_t = texture.m_wrap_t;
   m_internal_format = texture.m_internal_format;
   m_image_format = texture.m_image_format;
+  m_mipmaps = texture.m_mipmaps;
+  m_memory_usage = texture.m_memory_usage;
   texture.m_id = 0;
   return *this;
 }
 
 Texture2D::Texture2D(Texture2D &&texture)
     : m_id(texture.m_id), m_width(texture.m_width), m_height(texture.m_height),
-      m_internal_format(texture.m_internal_format),
+      m_levels(texture.m_levels), m_internal_format(texture.m_internal_format),
       m_image_format(texture.m_image_format), m_wrap_s(texture.m_wrap_s),
       m_wrap_t(texture.m_wrap_t), m_filter_min(texture.m_filter_min),
-      m_filter_max(texture.m_filter_max) {
+      m_filter_max(texture.m_filter_max), m_mipmaps(texture.m_mipmaps),
+      m_memory_usage(texture.m_memory_usage) {
   texture.m_id = 0;
 }
 
-void Texture2D::generate(uint32_t width, uint32_t height, unsigned char *data) {
+/* Immutable storage requires sized internal formats */
+static GLenum sized_format(int32_t internal_format) {
+  switch (internal_format) {
+  case GL_RED:
+    return GL_R8;
+  case GL_RGB:
+    return GL_RGB8;
+  case GL_RGBA:
+    return GL_RGBA8;
+  default:
+    return internal_format;
+  }
+}
+
+/* Drivers pad RGB8 texels to 4 bytes */
+static size_t bytes_per_texel(GLenum sized_format) {
+  return sized_format == GL_R8 ? 1 : 4;
+}
+
+static uint32_t mip_levels(uint32_t width, uint32_t height) {
+  uint32_t levels = 1;
+  for (uint32_t size = std::max(width, height); size > 1; size /= 2) {
+    ++levels;
+  }
+  return levels;
+}
+
+void Texture2D::generate(uint32_t width, uint32_t height,
+                         const unsigned char *data) {
+  const GLenum format = sized_format(m_internal_format);
+  allocate(width, height, m_mipmaps ? mip_levels(width, height) : 1, format);
+  if (data) {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, m_image_format,
+                    GL_UNSIGNED_BYTE, data);
+    if (m_levels > 1) {
+      glGenerateMipmap(GL_TEXTURE_2D);
+    }
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Texture2D::generate_from_buffer(uint32_t width, uint32_t height,
+                                     size_t offset) {
+  const GLenum format = sized_format(m_internal_format);
+  allocate(width, height, m_mipmaps ? mip_levels(width, height) : 1, format);
+  /* The source is the bound GL_PIXEL_UNPACK_BUFFER, so the upload doesn't
+   * block on the pixel transfer */
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, m_image_format,
+                  GL_UNSIGNED_BYTE, reinterpret_cast<const void *>(offset));
+  if (m_levels > 1) {
+    glGenerateMipmap(GL_TEXTURE_2D);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Texture2D::generate_compressed(const BlockCompression::Image &image) {
+  upload_compressed(image, image.data);
+}
+
+void Texture2D::generate_compressed_from_buffer(
+    const BlockCompression::Image &image, size_t offset) {
+  upload_compressed(image, reinterpret_cast<const unsigned char *>(offset));
+}
+
+void Texture2D::upload_compressed(const BlockCompression::Image &image,
+                                  const unsigned char *data) {
+  /* Use the mip chain the image comes with */
+  allocate(image.width, image.height, image.levels,
+           BlockCompression::gl_format(image.format));
+
+  m_memory_usage = 0;
+  uint32_t width = image.width, height = image.height;
+  for (uint32_t level = 0; level < image.levels; ++level) {
+    const size_t size = BlockCompression::level_size(image.format, width,
+                                                     height);
+    glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height,
+                              BlockCompression::gl_format(image.format),
+                              static_cast<GLsizei>(size), data);
+    data += size;
+    m_memory_usage += size;
+    width = std::max<uint32_t>(1, width / 2);
+    height = std::max<uint32_t>(1, height / 2);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Texture2D::allocate(uint32_t width, uint32_t height, uint32_t levels,
+                         uint32_t format) {
   m_width = width;
   m_height = height;
+  m_levels = levels;
 
   /* Create texture */
+  if (m_id == 0) {
+    glGenTextures(1, &m_id);
+  }
   glBindTexture(GL_TEXTURE_2D, m_id);
-  glTexImage2D(GL_TEXTURE_2D, 0, m_internal_format, m_width, m_height, 0,
-               m_image_format, GL_UNSIGNED_BYTE, data);
+  glTexStorage2D(GL_TEXTURE_2D, m_levels, format, m_width, m_height);
 
   /* Set texture's wrap and filter methods */
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, m_wrap_s);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, m_wrap_t);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, m_filter_min);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  m_levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : m_filter_min);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, m_filter_max);
 
-  /* Unbind texture */
-  glBindTexture(GL_TEXTURE_2D, 0);
+  /* Compressed uploads replace this with their exact size */
+  m_memory_usage = 0;
+  for (uint32_t level = 0; level < m_levels; ++level) {
+    m_memory_usage +=
+        static_cast<size_t>(std::max<uint32_t>(1, width >> level)) *
+        std::max<uint32_t>(1, height >> level) * bytes_per_texel(format);
+  }
 }
 
 void Texture2D::set_internal_format(int32_t format) {
@@ -61,7 +171,13 @@ void Texture2D::set_internal_format(int32_t format) {
 
 void Texture2D::set_image_format(uint32_t format) { m_image_format = format; }
 
+void Texture2D::set_mipmaps(bool mipmaps) { m_mipmaps = mipmaps; }
+
 void Texture2D::bind() const { glBindTexture(GL_TEXTURE_2D, m_id); }
 void Texture2D::unbind() const { glBindTexture(GL_TEXTURE_2D, 0); }
 
 uint32_t Texture2D::id() const { return m_id; }
+uint32_t Texture2D::width() const { return m_width; }
+uint32_t Texture2D::height() const { return m_height; }
+uint32_t Texture2D::levels() const { return m_levels; }
+size_t Texture2D::memory_usage() const { return m_memory_usage; }
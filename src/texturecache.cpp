@@ -0,0 +1,170 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include "breakout/hash.hpp"
+#include "breakout/log.hpp"
+#include "breakout/texture_cache.hpp"
+
+static const char CACHE_MAGIC[4] = {'B', 'T', 'X', 'C'};
+static const uint32_t CACHE_VERSION = 1;
+static const size_t TEXELS_ALIGNMENT = 16;
+
+struct CacheHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t count;
+  uint32_t reserved;
+};
+
+struct CacheRecord {
+  uint64_t key;
+  uint32_t width, height;
+  uint32_t channels, levels;
+  uint64_t offset, size;
+};
+
+uint64_t TextureCache::make_key(const void *source, size_t source_size,
+                                uint32_t channels) {
+  const uint64_t hash = Hash::fnv1a(source, source_size);
+  return Hash::fnv1a(&channels, sizeof(channels), hash);
+}
+
+bool TextureCache::open(const char *path) {
+  m_path = path;
+  m_retained.clear();
+  return map_entries();
+}
+
+bool TextureCache::map_entries() {
+  const char *path = m_path.c_str();
+  m_entries.clear();
+  if (!m_file.open(path)) {
+    return false;
+  }
+
+  const unsigned char *data = m_file.data();
+  const size_t size = m_file.size();
+
+  CacheHeader header;
+  if (size < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) ||
+      header.version != CACHE_VERSION ||
+      header.count > (size - sizeof(header)) / sizeof(CacheRecord)) {
+    LOG_WARN("Ignoring incompatible texture cache: {}", path);
+    m_file.close();
+    return false;
+  }
+
+  for (uint32_t i = 0; i < header.count; ++i) {
+    CacheRecord record;
+    std::memcpy(&record, data + sizeof(header) + i * sizeof(record),
+                sizeof(record));
+    if (record.offset > size || record.size > size - record.offset) {
+      LOG_WARN("Ignoring corrupted texture cache: {}", path);
+      m_entries.clear();
+      m_file.close();
+      return false;
+    }
+
+    m_entries[record.key] = {record.width,  record.height,
+                             record.channels, record.levels,
+                             data + record.offset, record.size};
+  }
+  return true;
+}
+
+const TextureCache::Entry *TextureCache::find(uint64_t key) const {
+  auto it = m_entries.find(key);
+  return it != m_entries.end() ? &it->second : nullptr;
+}
+
+void TextureCache::retain(uint64_t key) { m_retained[key] = true; }
+
+void TextureCache::store(uint64_t key, const Entry &entry) {
+  m_stored_texels.emplace_back(entry.texels, entry.texels + entry.size);
+
+  Entry stored = entry;
+  stored.texels = m_stored_texels.back().data();
+  m_entries[key] = stored;
+  m_retained[key] = true;
+  m_dirty = true;
+}
+
+bool TextureCache::save() {
+  if (!m_dirty || m_path.empty()) {
+    return true;
+  }
+  /* A failed write is tried again once something new is stored, rather
+   * than on every call */
+  m_dirty = false;
+
+  /* Write next to the destination and swap it in once complete, the old
+   * file stays mapped for as long as we need it */
+  const std::string tmp_path = m_path + ".tmp";
+  std::ofstream file(tmp_path, std::ios::binary);
+  if (!file) {
+    LOG_ERROR("Failed to write texture cache: {}", tmp_path);
+    return false;
+  }
+
+  CacheHeader header;
+  std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  header.version = CACHE_VERSION;
+  header.count = static_cast<uint32_t>(m_retained.size());
+  header.reserved = 0;
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+  std::vector<const Entry *> entries;
+  uint64_t offset = sizeof(header) + header.count * sizeof(CacheRecord);
+  for (const auto &retained : m_retained) {
+    const Entry &entry = m_entries.at(retained.first);
+    offset = (offset + TEXELS_ALIGNMENT - 1) / TEXELS_ALIGNMENT *
+             TEXELS_ALIGNMENT;
+
+    const CacheRecord record = {retained.first, entry.width,  entry.height,
+                                entry.channels, entry.levels, offset,
+                                entry.size};
+    file.write(reinterpret_cast<const char *>(&record), sizeof(record));
+
+    entries.push_back(&entry);
+    offset += entry.size;
+  }
+
+  for (const Entry *entry : entries) {
+    static const char padding[TEXELS_ALIGNMENT] = {0};
+    const size_t position = static_cast<size_t>(file.tellp());
+    file.write(padding, (TEXELS_ALIGNMENT - position % TEXELS_ALIGNMENT) %
+                            TEXELS_ALIGNMENT);
+    file.write(reinterpret_cast<const char *>(entry->texels), entry->size);
+  }
+
+  file.close();
+  if (!file) {
+    LOG_ERROR("Failed to write texture cache: {}", tmp_path);
+    std::remove(tmp_path.c_str());
+    return false;
+  }
+
+#ifdef _WIN32
+  std::remove(m_path.c_str());
+#endif /* _WIN32 */
+  if (std::rename(tmp_path.c_str(), m_path.c_str())) {
+    LOG_ERROR("Failed to replace texture cache: {}", m_path);
+    return false;
+  }
+
+  /* Texels stored since the last save are in the new file now */
+  const bool mapped = map_entries();
+  m_stored_texels.clear();
+  if (!mapped) {
+    LOG_WARN("Failed to map the saved texture cache: {}", m_path);
+    m_retained.clear();
+    return false;
+  }
+  return true;
+}
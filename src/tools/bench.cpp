@@ -0,0 +1,383 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "breakout/ballobject.hpp"
+#include "breakout/breakout_game.hpp"
+#include "breakout/gamelevel.hpp"
+#include "breakout/gameobject.hpp"
+#include "breakout/particle.hpp"
+#include "breakout/shader.hpp"
+#include "breakout/sprite_renderer.hpp"
+#include "breakout/text_renderer.hpp"
+
+/* Microbenchmarks: breakout_bench [--filter <substring>] [--out <path>]
+ *                                 [--min-time <seconds>]
+ *
+ * Every benchmark is timed over SAMPLES batches, each long enough to take
+ * a fraction of `--min-time`. The per-operation medians are written as JSON
+ * to stdout or `--out`, a summary goes to stderr. Benchmarks that need
+ * OpenGL run in a hidden context and are reported as skipped without one */
+
+static const size_t SAMPLES = 5;
+static const uint32_t WINDOW_WIDTH = 800;
+static const uint32_t WINDOW_HEIGHT = 600;
+
+/* Keeps the compiler from optimizing away the computation of `value` */
+template <typename T> static void keep(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "g"(&value) : "memory");
+#else
+  static const void *volatile sink;
+  sink = &value;
+#endif /* __GNUC__ || __clang__ */
+}
+
+struct Result {
+  std::string name;
+  uint64_t iterations;
+  double median_ns;
+  double min_ns;
+  double max_ns;
+};
+
+class Bench {
+public:
+  Bench(const char *filter, double min_time)
+      : m_filter(filter), m_min_time(min_time) {}
+
+  bool enabled(const char *name) const {
+    return !m_filter || std::strstr(name, m_filter);
+  }
+
+  /* Times `operation`, which is called once per iteration */
+  template <typename F> void run(const char *name, F operation) {
+    if (!enabled(name)) {
+      return;
+    }
+
+    /* Grow the batch until it takes long enough to time reliably */
+    const double batch_time = m_min_time / SAMPLES;
+    uint64_t iterations = 1;
+    while (time_batch(operation, iterations) < batch_time &&
+           iterations < (1ull << 40)) {
+      iterations *= 2;
+    }
+
+    double samples[SAMPLES];
+    for (double &sample : samples) {
+      sample = time_batch(operation, iterations) * 1e9 / iterations;
+    }
+    std::sort(samples, samples + SAMPLES);
+
+    m_results.push_back({name, iterations, samples[SAMPLES / 2], samples[0],
+                         samples[SAMPLES - 1]});
+    std::fprintf(stderr, "%-32s %12.1f ns/op (min %.1f, max %.1f)\n", name,
+                 samples[SAMPLES / 2], samples[0], samples[SAMPLES - 1]);
+  }
+
+  void skip(const char *name) {
+    if (enabled(name)) {
+      m_skipped.push_back(name);
+      std::fprintf(stderr, "%-32s skipped, no OpenGL context\n", name);
+    }
+  }
+
+  void write_json(FILE *file) const {
+    std::fprintf(file, "{\n  \"benchmarks\": [");
+    for (size_t i = 0; i < m_results.size(); ++i) {
+      const Result &result = m_results[i];
+      std::fprintf(file,
+                   "%s\n    {\"name\": \"%s\", \"iterations\": %llu, "
+                   "\"ns_per_op\": %.3f, \"min_ns_per_op\": %.3f, "
+                   "\"max_ns_per_op\": %.3f}",
+                   i ? "," : "", result.name.c_str(),
+                   static_cast<unsigned long long>(result.iterations),
+                   result.median_ns, result.min_ns, result.max_ns);
+    }
+    std::fprintf(file, "\n  ],\n  \"skipped\": [");
+    for (size_t i = 0; i < m_skipped.size(); ++i) {
+      std::fprintf(file, "%s\"%s\"", i ? ", " : "", m_skipped[i].c_str());
+    }
+    std::fprintf(file, "]\n}\n");
+  }
+
+private:
+  template <typename F> static double time_batch(F &operation, uint64_t n) {
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < n; ++i) {
+      operation();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+  }
+
+private:
+  const char *m_filter;
+  double m_min_time;
+  std::vector<Result> m_results;
+  std::vector<std::string> m_skipped;
+};
+
+/* Deterministic inputs, so that runs are comparable across commits */
+static uint32_t next_random(uint32_t &state) {
+  state = state * 1664525u + 1013904223u;
+  return state >> 8;
+}
+
+static float random_float(uint32_t &state, float min, float max) {
+  return min + (max - min) * (next_random(state) & 0xffff) / 65535.0f;
+}
+
+/* A level file of `rows` x `columns` tiles, with every kind of block */
+static std::string make_level(uint32_t rows, uint32_t columns) {
+  uint32_t state = rows * 31 + columns;
+  std::string level;
+  for (uint32_t y = 0; y < rows; ++y) {
+    for (uint32_t x = 0; x < columns; ++x) {
+      level += static_cast<char>('0' + next_random(state) % 6);
+      level += x + 1 < columns ? ' ' : '\n';
+    }
+  }
+  return level;
+}
+
+static GameLevel load_level(const std::string &data) {
+  GameLevel level;
+  level.load_from_buffer(data.data(), data.size(), WINDOW_HEIGHT,
+                         WINDOW_WIDTH, WINDOW_HEIGHT / 2,
+                         GameLevel::Sprites());
+  return level;
+}
+
+static std::vector<glm::vec2> random_positions(size_t count) {
+  uint32_t state = 7;
+  std::vector<glm::vec2> positions;
+  for (size_t i = 0; i < count; ++i) {
+    positions.emplace_back(random_float(state, 0.0f, WINDOW_WIDTH),
+                           random_float(state, 0.0f, WINDOW_HEIGHT));
+  }
+  return positions;
+}
+
+static void bench_collisions(Bench &bench) {
+  uint32_t state = 1;
+  std::vector<glm::vec2> directions;
+  for (size_t i = 0; i < 1024; ++i) {
+    directions.emplace_back(random_float(state, -1.0f, 1.0f),
+                            random_float(state, 0.01f, 1.0f));
+  }
+  size_t next = 0;
+  bench.run("vector_direction", [&]() {
+    keep(vector_direction(directions[next++ & 1023]));
+  });
+
+  GameLevel small = load_level(make_level(8, 15));
+  std::vector<GameObject> &bricks = small.bricks();
+  const std::vector<glm::vec2> positions = random_positions(1024);
+  BallObject ball(glm::vec2(0.0f), BallObject::INITIAL_RADIUS,
+                  BallObject::INITIAL_VELOCITY, TextureHandle());
+  next = 0;
+  bench.run("check_collision/ball", [&]() {
+    ball.position = positions[next & 1023];
+    keep(check_collision(ball, bricks[next++ % bricks.size()]));
+  });
+
+  GameObject paddle(glm::vec2(WINDOW_WIDTH / 2.0f, 20.0f),
+                    glm::vec2(100.0f, 20.0f), TextureHandle());
+  next = 0;
+  bench.run("check_collision/aabb", [&]() {
+    paddle.position = positions[next & 1023];
+    keep(check_collision(paddle, bricks[next++ % bricks.size()]));
+  });
+
+  /* Mostly misses, which scan every brick like a ball in open space does */
+  GameLevel huge = load_level(make_level(256, 256));
+  const char *names[] = {"resolve_box_collisions/small",
+                         "resolve_box_collisions/huge"};
+  GameLevel *levels[] = {&small, &huge};
+  for (size_t i = 0; i < 2; ++i) {
+    std::vector<GameObject> &level_bricks = levels[i]->bricks();
+    Collision collision(false, glm::vec2(0.0f), glm::vec2(0.0f));
+    next = 0;
+    bench.run(names[i], [&]() {
+      ball.position = positions[next++ & 1023];
+      keep(find_box_collision(ball, level_bricks, collision));
+    });
+  }
+}
+
+static void bench_level_parsing(Bench &bench) {
+  const std::string small = make_level(8, 15);
+  const std::string huge = make_level(256, 256);
+  GameLevel level;
+  bench.run("level_load/small", [&]() {
+    level.load_from_buffer(small.data(), small.size(), WINDOW_HEIGHT,
+                           WINDOW_WIDTH, WINDOW_HEIGHT / 2,
+                           GameLevel::Sprites());
+    keep(level);
+  });
+  bench.run("level_load/huge", [&]() {
+    level.load_from_buffer(huge.data(), huge.size(), WINDOW_HEIGHT,
+                           WINDOW_WIDTH, WINDOW_HEIGHT / 2,
+                           GameLevel::Sprites());
+    keep(level);
+  });
+}
+
+static void bench_vertices(Bench &bench) {
+  const std::vector<glm::vec2> positions = random_positions(1024);
+  size_t next = 0;
+  bench.run("sprite/model_matrix", [&]() {
+    const glm::vec2 &position = positions[next++ & 1023];
+    keep(SpriteRenderer::model_matrix(position, glm::vec2(60.0f, 20.0f),
+                                      position.x));
+  });
+
+  /* Glyph metrics of a 24px font, looked up like TextRenderer::render */
+  TextRenderer::CharMap characters;
+  for (unsigned char c = 32; c < 128; ++c) {
+    characters[c] = {0, glm::ivec2(8 + c % 7, 18), glm::ivec2(1, 16),
+                     (10 + c % 5) << 6};
+  }
+  const char *text = "Press ENTER to retry or ESC to quit";
+  float vertices[64][4][4];
+  bench.run("text/glyph_quads", [&]() {
+    float x = 130.0f;
+    size_t count = 0;
+    for (const char *c = text; *c; ++c) {
+      const TextCharacter &ch = characters.find(*c)->second;
+      TextRenderer::glyph_quad(ch, x, 300.0f, 1.0f, vertices[count++]);
+      x += (ch.advance >> 6) * 1.0f;
+    }
+    keep(vertices);
+  });
+}
+
+static const char *SPRITE_VERTEX_SOURCE = R"(#version 430 core
+layout (location = 0) in vec4 vertex;
+out vec2 tex_coords;
+uniform mat4 model;
+uniform mat4 projection;
+void main() {
+  tex_coords = vertex.zw;
+  gl_Position = projection * model * vec4(vertex.xy, 0.0, 1.0);
+}
+)";
+
+static const char *SPRITE_FRAGMENT_SOURCE = R"(#version 430 core
+in vec2 tex_coords;
+out vec4 color;
+uniform sampler2D image;
+uniform vec3 spriteColor;
+void main() {
+  color = vec4(spriteColor, 1.0) * texture(image, tex_coords);
+}
+)";
+
+static void bench_gl(Bench &bench) {
+  Shader shader(SPRITE_VERTEX_SOURCE, SPRITE_FRAGMENT_SOURCE);
+  const char *uniforms[] = {"model", "projection", "image", "spriteColor"};
+  size_t next = 0;
+  bench.run("shader/find_uniform", [&]() {
+    keep(shader.find_uniform(uniforms[next++ & 3]));
+  });
+
+  ParticleGenerator particles(nullptr, TextureHandle(), 500);
+  BallObject ball(glm::vec2(WINDOW_WIDTH / 2.0f, WINDOW_HEIGHT / 2.0f),
+                  BallObject::INITIAL_RADIUS, BallObject::INITIAL_VELOCITY,
+                  TextureHandle());
+  const glm::vec2 offset(ball.radius / 2.0f, -ball.radius);
+  bench.run("particles/update", [&]() {
+    particles.update(1.0f / 120.0f, ball, 2, offset);
+    keep(particles);
+  });
+}
+
+/* A hidden window is enough, it is never presented */
+static GLFWwindow *create_context() {
+#ifdef GLFW_PLATFORM_NULL
+  glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif /* GLFW_PLATFORM_NULL */
+  if (!glfwInit()) {
+    return nullptr;
+  }
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+  GLFWwindow *window =
+      glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "bench", nullptr, nullptr);
+  if (!window) {
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+    window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "bench", nullptr,
+                              nullptr);
+  }
+  if (!window) {
+    return nullptr;
+  }
+  glfwMakeContextCurrent(window);
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    glfwDestroyWindow(window);
+    return nullptr;
+  }
+  return window;
+}
+
+int main(int argc, char *argv[]) {
+  const char *filter = nullptr;
+  const char *out_path = nullptr;
+  double min_time = 1.0;
+  for (int i = 1; i < argc; ++i) {
+    const bool has_value = i + 1 < argc;
+    if (!std::strcmp(argv[i], "--filter") && has_value) {
+      filter = argv[++i];
+    } else if (!std::strcmp(argv[i], "--out") && has_value) {
+      out_path = argv[++i];
+    } else if (!std::strcmp(argv[i], "--min-time") && has_value) {
+      min_time = std::strtod(argv[++i], nullptr);
+    } else {
+      std::fprintf(stderr,
+                   "usage: %s [--filter <substring>] [--out <path>] "
+                   "[--min-time <seconds>]\n",
+                   argv[0]);
+      return 1;
+    }
+  }
+
+  Bench bench(filter, min_time);
+  bench_collisions(bench);
+  bench_level_parsing(bench);
+  bench_vertices(bench);
+
+  if (GLFWwindow *window = create_context()) {
+    bench_gl(bench);
+    glfwDestroyWindow(window);
+  } else {
+    bench.skip("shader/find_uniform");
+    bench.skip("particles/update");
+  }
+  glfwTerminate();
+
+  FILE *file = out_path ? std::fopen(out_path, "w") : stdout;
+  if (!file) {
+    std::fprintf(stderr, "failed to open %s\n", out_path);
+    return 1;
+  }
+  bench.write_json(file);
+  if (file != stdout) {
+    std::fclose(file);
+  }
+  return 0;
+}
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "breakout/hash.hpp"
+#include "breakout/memory.hpp"
+#include "breakout/resource_pack.hpp"
+
+/* Resource pack builder: packbuilder <output> <base dir> <file>...
+ *
+ * Files are stored under their path relative to `base dir`, which is how the
+ * game refers to them (e.g. res/textures/block.png) */
+
+struct Blob {
+  Memory::MappedFile file;
+  uint64_t offset;
+};
+
+struct PackedFile {
+  std::string path;
+  uint64_t path_hash;
+  size_t blob;
+};
+
+static std::string relative_path(std::string path, std::string base) {
+  std::replace(path.begin(), path.end(), '\\', '/');
+  std::replace(base.begin(), base.end(), '\\', '/');
+  if (!base.empty() && base.back() != '/') {
+    base += '/';
+  }
+  return path.compare(0, base.size(), base) ? path : path.substr(base.size());
+}
+
+static uint64_t align(uint64_t offset) {
+  return (offset + ResourcePack::DATA_ALIGNMENT - 1) /
+         ResourcePack::DATA_ALIGNMENT * ResourcePack::DATA_ALIGNMENT;
+}
+
+static void write_padding(std::ofstream &file, uint64_t offset) {
+  static const char zeros[ResourcePack::DATA_ALIGNMENT] = {0};
+  const uint64_t position = static_cast<uint64_t>(file.tellp());
+  file.write(zeros, offset - position);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 4) {
+    std::fprintf(stderr, "usage: %s <output> <base dir> <file>...\n",
+                 argv[0]);
+    return 1;
+  }
+
+  std::vector<std::unique_ptr<Blob>> blobs;
+  std::unordered_multimap<uint64_t, size_t> blobs_by_hash;
+  std::vector<PackedFile> files;
+  size_t total_size = 0, packed_size = 0;
+
+  for (int i = 3; i < argc; ++i) {
+    std::unique_ptr<Blob> blob(new Blob());
+    if (!blob->file.open(argv[i])) {
+      std::fprintf(stderr, "failed to read %s\n", argv[i]);
+      return 1;
+    }
+
+    const std::string path = relative_path(argv[i], argv[2]);
+    const unsigned char *data = blob->file.data();
+    const size_t size = blob->file.size();
+    total_size += size;
+
+    /* Store identical files once */
+    const uint64_t content_hash = Hash::fnv1a(data, size);
+    size_t blob_index = blobs.size();
+    auto range = blobs_by_hash.equal_range(content_hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      const Memory::MappedFile &other = blobs[it->second]->file;
+      if (other.size() == size && !std::memcmp(other.data(), data, size)) {
+        blob_index = it->second;
+        std::printf("%s: duplicate content, stored once\n", path.c_str());
+        break;
+      }
+    }
+
+    if (blob_index == blobs.size()) {
+      blobs_by_hash.emplace(content_hash, blob_index);
+      blobs.push_back(std::move(blob));
+      packed_size += size;
+    }
+
+    files.push_back(
+        {path, Hash::fnv1a(path.data(), path.size()), blob_index});
+  }
+
+  std::sort(files.begin(), files.end(),
+            [](const PackedFile &a, const PackedFile &b) {
+              return a.path_hash < b.path_hash;
+            });
+
+  /* Layout: header, index records, path strings, aligned data blobs */
+  ResourcePack::Header header;
+  std::memcpy(header.magic, ResourcePack::MAGIC, sizeof(header.magic));
+  header.version = ResourcePack::VERSION;
+  header.count = static_cast<uint32_t>(files.size());
+  header.reserved = 0;
+
+  uint64_t offset =
+      sizeof(header) + files.size() * sizeof(ResourcePack::Record);
+  std::vector<uint64_t> path_offsets;
+  for (const PackedFile &file : files) {
+    path_offsets.push_back(offset);
+    offset += file.path.size() + 1;
+  }
+  for (std::unique_ptr<Blob> &blob : blobs) {
+    blob->offset = offset = align(offset);
+    /* Trailing NUL byte */
+    offset += blob->file.size() + 1;
+  }
+
+  std::ofstream output(argv[1], std::ios::binary);
+  if (!output) {
+    std::fprintf(stderr, "failed to open %s\n", argv[1]);
+    return 1;
+  }
+
+  output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  for (size_t i = 0; i < files.size(); ++i) {
+    const Blob &blob = *blobs[files[i].blob];
+    const ResourcePack::Record record = {files[i].path_hash, path_offsets[i],
+                                         blob.offset, blob.file.size()};
+    output.write(reinterpret_cast<const char *>(&record), sizeof(record));
+  }
+  for (const PackedFile &file : files) {
+    output.write(file.path.c_str(), file.path.size() + 1);
+  }
+  for (const std::unique_ptr<Blob> &blob : blobs) {
+    write_padding(output, blob->offset);
+    output.write(reinterpret_cast<const char *>(blob->file.data()),
+                 blob->file.size());
+    output.put('\0');
+  }
+
+  if (!output) {
+    std::fprintf(stderr, "failed to write %s\n", argv[1]);
+    return 1;
+  }
+
+  std::printf("packed %zu files (%zu unique) into %s: %zu -> %zu bytes\n",
+              files.size(), blobs.size(), argv[1], total_size, packed_size);
+  return 0;
+}
@@ -0,0 +1,297 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif /* _WIN32 */
+
+#include "breakout/ballobject.hpp"
+#include "breakout/breakout_game.hpp"
+#include "breakout/frame_stats.hpp"
+#include "breakout/memory.hpp"
+#include "breakout/player.hpp"
+#include "breakout/powerup.hpp"
+#include "breakout/resource_manager.hpp"
+#include "breakout/resource_pack.hpp"
+
+/* Soak test: breakout_soak [--ticks <n>] [--level-ticks <n>]
+ *                          [--pack <path>] [--seed <n>] [--strict]
+ *
+ * Plays every level in turn without a window, with an autopilot on the
+ * paddle, and reports simulation throughput, tick times, peak memory and
+ * heap allocations. A level that isn't won within `--level-ticks` is given
+ * up by letting the ball drop, so that long runs visit all of them.
+ *
+ * Ticks of a level in progress are expected not to allocate, `--strict`
+ * fails the run if any of them does */
+
+static const uint32_t WIDTH = 800;
+static const uint32_t HEIGHT = 600;
+static const float TICK = 1.0f / 120.0f;
+
+static uint64_t allocation_count() {
+  return Memory::thread_allocations().allocations;
+}
+
+/* Holds the paddle keys like a player would, aiming for where the ball
+ * comes down or, while it is on its way up, for a falling power-up */
+class Autopilot {
+public:
+  explicit Autopilot(BreakoutGame &game) : m_game(game) {}
+  Autopilot(const Autopilot &) = delete;
+  Autopilot(Autopilot &&) = delete;
+  Autopilot &operator=(const Autopilot &) = delete;
+  Autopilot &operator=(Autopilot &&) = delete;
+
+  void steer(double time) {
+    const BallObject &ball = m_game.ball();
+    const Player &player = m_game.player();
+    if (ball.is_stuck) {
+      tap(time, KeyCode::KEY_SPACE);
+    }
+
+    /* Don't chase the exact pixel, a paddle has some width to it */
+    const float center = player.position.x + player.size.x / 2.0f;
+    const float tolerance = player.size.x / 4.0f;
+    const float target = target_x();
+    hold(time, KeyCode::KEY_A, target < center - tolerance);
+    hold(time, KeyCode::KEY_D, target > center + tolerance);
+  }
+
+  /* Launches the ball but lets it drop, to run out of lives */
+  void give_up(double time) {
+    if (m_game.ball().is_stuck) {
+      tap(time, KeyCode::KEY_SPACE);
+    }
+    hold(time, KeyCode::KEY_A, false);
+    hold(time, KeyCode::KEY_D, false);
+  }
+
+  /* A press that is released again on the next tick */
+  void tap(double time, KeyCode key) {
+    m_game.input().push_event(time, key, true);
+    m_game.input().push_event(time, key, false);
+  }
+
+private:
+  void hold(double time, KeyCode key, bool pressed) {
+    bool &held = key == KeyCode::KEY_A ? m_left : m_right;
+    if (held != pressed) {
+      m_game.input().push_event(time, key, pressed);
+      held = pressed;
+    }
+  }
+
+  float target_x() const {
+    const BallObject &ball = m_game.ball();
+    const Player &player = m_game.player();
+    const float ball_x = ball.position.x + ball.radius;
+    if (ball.is_stuck) {
+      return ball_x;
+    }
+
+    if (ball.velocity.y >= 0.0f) {
+      /* Lowest falling power-up that can still be caught */
+      const PowerUp *closest = nullptr;
+      for (const PowerUp &powerup : m_game.powerups()) {
+        if (!powerup.is_destroyed &&
+            powerup.position.y - powerup.size.y >= player.position.y &&
+            (!closest || powerup.position.y < closest->position.y)) {
+          closest = &powerup;
+        }
+      }
+      return closest ? closest->position.x + closest->size.x / 2.0f : ball_x;
+    }
+
+    /* Follow the ball down to the paddle, folding in the side walls */
+    const float drop = ball.position.y - 2.0f * ball.radius - player.position.y;
+    const float x = ball_x + ball.velocity.x * (drop / -ball.velocity.y);
+    const float min = ball.radius, range = WIDTH - 2.0f * ball.radius;
+    const float folded = std::fmod(std::fabs(x - min), 2.0f * range);
+    return min + (folded > range ? 2.0f * range - folded : folded);
+  }
+
+private:
+  BreakoutGame &m_game;
+  bool m_left = false;
+  bool m_right = false;
+};
+
+static size_t peak_memory_kib() {
+#ifndef _WIN32
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    return static_cast<size_t>(usage.ru_maxrss);
+  }
+#endif /* _WIN32 */
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  uint64_t ticks = 120 * 60 * 10;
+  uint64_t level_ticks = 120 * 60 * 2;
+  const char *pack_path = "breakout.pack";
+  bool strict = false;
+  uint32_t seed = std::minstd_rand::default_seed;
+  for (int i = 1; i < argc; ++i) {
+    const bool has_value = i + 1 < argc;
+    if (!std::strcmp(argv[i], "--ticks") && has_value) {
+      ticks = std::strtoull(argv[++i], nullptr, 10);
+    } else if (!std::strcmp(argv[i], "--level-ticks") && has_value) {
+      level_ticks = std::strtoull(argv[++i], nullptr, 10);
+    } else if (!std::strcmp(argv[i], "--pack") && has_value) {
+      pack_path = argv[++i];
+    } else if (!std::strcmp(argv[i], "--seed") && has_value) {
+      seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (!std::strcmp(argv[i], "--strict")) {
+      strict = true;
+    } else {
+      std::fprintf(stderr,
+                   "usage: %s [--ticks <n>] [--level-ticks <n>] "
+                   "[--pack <path>] [--seed <n>] [--strict]\n",
+                   argv[0]);
+      return 1;
+    }
+  }
+
+  ResourcePack::mount(pack_path);
+  BreakoutGame game(WIDTH, HEIGHT, AudioBackend::DISABLED);
+  game.init_simulation();
+  game.seed(seed);
+  Autopilot autopilot(game);
+
+  FrameStats tick_stats;
+  tick_stats.reserve(ticks);
+
+  uint64_t levels_won = 0, levels_abandoned = 0, lives_lost = 0;
+  uint64_t ticks_in_level = 0, allocating_ticks = 0, max_allocations = 0;
+  uint64_t input_allocations = 0, update_allocations = 0;
+  uint64_t steady_ticks = 0, steady_allocating_ticks = 0;
+  size_t peak_powerups = 0;
+  bool advance = false, giving_up = false;
+  int32_t lives = game.lives();
+  const uint64_t allocations_before = allocation_count();
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+
+  for (uint64_t tick = 0; tick < ticks; ++tick) {
+    const double time = tick * static_cast<double>(TICK);
+
+    switch (game.state()) {
+    case GameState::MENU:
+      /* Either the level was won or all lives are gone */
+      if (giving_up || advance) {
+        levels_abandoned += giving_up;
+        giving_up = false;
+        advance = false;
+        autopilot.tap(time, KeyCode::KEY_W);
+      } else {
+        autopilot.tap(time, KeyCode::KEY_ENTER);
+        ticks_in_level = 0;
+      }
+      break;
+
+    case GameState::WIN:
+      ++levels_won;
+      advance = true;
+      autopilot.tap(time, KeyCode::KEY_ENTER);
+      break;
+
+    case GameState::ACTIVE:
+      if (++ticks_in_level > level_ticks) {
+        giving_up = true;
+      }
+      if (giving_up) {
+        autopilot.give_up(time);
+      } else {
+        autopilot.steer(time);
+      }
+      break;
+    }
+
+    const GameState state = game.state();
+    const size_t level = game.current_level();
+    const uint64_t preloads = game.preloads_started();
+    const uint64_t allocations = allocation_count();
+    const std::chrono::steady_clock::time_point tick_start =
+        std::chrono::steady_clock::now();
+
+    game.input().apply_events(time);
+    game.process_input(TICK);
+    const bool simulating = game.is_simulating();
+    if (simulating) {
+      game.update(TICK);
+    }
+
+    tick_stats.add(std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - tick_start)
+                       .count());
+    const uint64_t tick_allocations = allocation_count() - allocations;
+    allocating_ticks += tick_allocations > 0;
+    max_allocations = std::max(max_allocations, tick_allocations);
+    input_allocations += game.allocations().input;
+    if (simulating) {
+      update_allocations += game.allocations().update;
+    }
+
+    /* Starting, finishing, switching or preloading levels may allocate,
+     * the ticks in between shouldn't */
+    if (state == GameState::ACTIVE && game.state() == GameState::ACTIVE &&
+        level == game.current_level() &&
+        preloads == game.preloads_started()) {
+      ++steady_ticks;
+      steady_allocating_ticks += tick_allocations > 0;
+    }
+
+    peak_powerups = std::max(peak_powerups, game.powerups().size());
+    /* Lives are refilled as soon as the last one is gone */
+    if (game.lives() < lives ||
+        (game.lives() > lives && game.state() == GameState::MENU)) {
+      ++lives_lost;
+    }
+    lives = game.lives();
+  }
+
+  const double elapsed = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  const uint64_t allocations = allocation_count() - allocations_before;
+
+  std::printf("ticks: %llu (%.1f simulated seconds)\n",
+              static_cast<unsigned long long>(ticks), ticks * TICK);
+  std::printf("levels won: %llu, abandoned: %llu, lives lost: %llu\n",
+              static_cast<unsigned long long>(levels_won),
+              static_cast<unsigned long long>(levels_abandoned),
+              static_cast<unsigned long long>(lives_lost));
+  std::printf("ticks per second: %.0f\n", ticks / elapsed);
+  std::printf("tick time (us): avg %.3f p50 %.3f p99 %.3f p99.9 %.3f "
+              "max %.3f\n",
+              tick_stats.average() * 1000.0,
+              tick_stats.percentile(50.0) * 1000.0,
+              tick_stats.percentile(99.0) * 1000.0,
+              tick_stats.percentile(99.9) * 1000.0,
+              tick_stats.max() * 1000.0);
+  std::printf("peak memory: %zu KiB\n", peak_memory_kib());
+  std::printf("allocations: %llu total, %.3f per tick, max %llu in one "
+              "tick, %llu ticks allocating\n",
+              static_cast<unsigned long long>(allocations),
+              ticks ? static_cast<double>(allocations) / ticks : 0.0,
+              static_cast<unsigned long long>(max_allocations),
+              static_cast<unsigned long long>(allocating_ticks));
+  std::printf("allocations by phase: input %llu, update %llu\n",
+              static_cast<unsigned long long>(input_allocations),
+              static_cast<unsigned long long>(update_allocations));
+  std::printf("steady-state ticks allocating: %llu of %llu\n",
+              static_cast<unsigned long long>(steady_allocating_ticks),
+              static_cast<unsigned long long>(steady_ticks));
+  std::printf("power-ups: peak %zu, at end %zu\n", peak_powerups,
+              game.powerups().size());
+
+  ResourceManager::clear();
+  return strict && steady_allocating_ticks > 0 ? 1 : 0;
+}
@@ -0,0 +1,60 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "breakout/block_compression.hpp"
+
+/* Offline BC1/BC3 encoder:
+ *   texcompress --alpha|--opaque <input image> <output.dds>
+ *
+ * Takes the format from how the game registers the texture rather than from
+ * the image: `--alpha` stores BC3, `--opaque` BC1. A full mip chain is
+ * always generated */
+int main(int argc, char *argv[]) {
+  const bool has_flag = argc == 4 && (!std::strcmp(argv[1], "--alpha") ||
+                                      !std::strcmp(argv[1], "--opaque"));
+  if (!has_flag) {
+    std::fprintf(stderr,
+                 "usage: %s --alpha|--opaque <input image> <output.dds>\n",
+                 argv[0]);
+    return 1;
+  }
+  const bool alpha = !std::strcmp(argv[1], "--alpha");
+  const char *input = argv[2];
+  const char *output = argv[3];
+
+  /* Sources without alpha come out opaque, as they do when the game
+   * decodes them itself */
+  int width, height;
+  unsigned char *pixels = stbi_load(input, &width, &height, nullptr, 4);
+  if (!pixels) {
+    std::fprintf(stderr, "failed to load image %s: %s\n", input,
+                 stbi_failure_reason());
+    return 1;
+  }
+
+  BlockCompression::Image image;
+  image.format =
+      alpha ? BlockCompression::Format::BC3 : BlockCompression::Format::BC1;
+  image.width = width;
+  image.height = height;
+
+  const std::vector<unsigned char> data = BlockCompression::encode(
+      image.format, pixels, width, height, &image.levels);
+  stbi_image_free(pixels);
+
+  image.data = data.data();
+  image.size = data.size();
+  if (!BlockCompression::write_dds(output, image)) {
+    std::fprintf(stderr, "failed to write %s\n", output);
+    return 1;
+  }
+
+  std::printf("%s -> %s (%s, %dx%d, %u levels, %zu bytes)\n", input, output,
+              image.format == BlockCompression::Format::BC1 ? "BC1" : "BC3",
+              width, height, image.levels, image.size);
+  return 0;
+}
@@ -0,0 +1,76 @@
+#include <utility>
+
+#include "breakout/worker_pool.hpp"
+
+WorkerPool::WorkerPool(size_t threads) {
+  m_workers.reserve(threads);
+  for (size_t i = 0; i < threads; ++i) {
+    m_workers.emplace_back(&WorkerPool::run, this);
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  wait();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_job_added.notify_all();
+  for (std::thread &worker : m_workers) {
+    worker.join();
+  }
+}
+
+void WorkerPool::submit(std::function<void()> job) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_jobs.push_back(std::move(job));
+    ++m_unfinished;
+  }
+  m_job_added.notify_one();
+}
+
+void WorkerPool::wait() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  /* Captures are released before waiters are told the job is done */
+  std::function<void()> job;
+  while (pop_job(job)) {
+    lock.unlock();
+    job();
+    job = nullptr;
+    lock.lock();
+    finish_job();
+  }
+  m_jobs_done.wait(lock, [this]() { return m_unfinished == 0; });
+}
+
+void WorkerPool::run() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  std::function<void()> job;
+  for (;;) {
+    m_job_added.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+    if (!pop_job(job)) {
+      return;
+    }
+    lock.unlock();
+    job();
+    job = nullptr;
+    lock.lock();
+    finish_job();
+  }
+}
+
+bool WorkerPool::pop_job(std::function<void()> &job) {
+  if (m_jobs.empty()) {
+    return false;
+  }
+  job = std::move(m_jobs.front());
+  m_jobs.pop_front();
+  return true;
+}
+
+void WorkerPool::finish_job() {
+  if (--m_unfinished == 0) {
+    m_jobs_done.notify_all();
+  }
+}